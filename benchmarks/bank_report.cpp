@@ -0,0 +1,66 @@
+#include "bank_sim.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace swlb;
+
+const int NROWS = 1080;
+const int NCOLS = 1920;
+
+const char* portsName(const RamPorts ports) {
+  if (ports == SINGLE_PORT) {
+    return "single";
+  } else if (ports == SIMPLE_DUAL_PORT) {
+    return "simple-dual";
+  }
+  return "true-dual";
+}
+
+void report(const char* layout, const BankedLineBuffer& lb) {
+  BankSimReport r = simulateBanks(lb);
+
+  int peakReads = 0;
+  for (auto& bank : r.banks) {
+    peakReads = max(peakReads, bank.peakReads);
+  }
+
+  cout << layout << "," << lb.windowRows << "x" << lb.windowCols << "," << portsName(lb.ports) << ","
+       << lb.numRAMs() << "," << lb.ramWidth << "," << r.initiationInterval() << ","
+       << r.pixelsPerClock() << "," << r.outputsPerClock() << ","
+       << r.conflictPixels << "," << peakReads << endl;
+}
+
+template<int KernelSize>
+void reportKernel(const RamPorts ports) {
+  BankedLineBuffer full = imageBufferBanks<KernelSize, KernelSize, NROWS, NCOLS>(ports);
+  report("imagebuffer", full);
+
+  BankedLineBuffer registers = full;
+  registers.reads = REGISTER_WINDOW;
+  report("register-window", registers);
+
+  // One RAM per buffered image row, and nothing more.
+  BankedLineBuffer lines = registers;
+  lines.lbSize = (KernelSize - 1)*NCOLS;
+  report("line-rams", lines);
+}
+
+// Simulates 1080p line buffers banked one RAM per image row, for square
+// windows and each kind of RAM port, and prints the sustained rate:
+//   imagebuffer      ImageBuffer's layout, reading every tap of each window
+//   register-window  the same layout, reading only the entering column as
+//                    ImageBuffer3x3 does
+//   line-rams        KernelSize - 1 RAMs of exactly one row each, read first
+// An initiation interval of 1 means a pixel every clock.
+int main() {
+  cout << "layout,window,ports,rams,ram_width,initiation_interval,pixels_per_clock,outputs_per_clock,conflict_pixels,peak_reads_per_ram" << endl;
+
+  const RamPorts ports[] = {SINGLE_PORT, SIMPLE_DUAL_PORT, TRUE_DUAL_PORT};
+  for (auto p : ports) {
+    reportKernel<3>(p);
+    reportKernel<5>(p);
+    reportKernel<7>(p);
+  }
+  return 0;
+}
@@ -0,0 +1,404 @@
+#pragma once
+
+#include "harness.h"
+
+#include <cctype>
+#include <fstream>
+#include <map>
+
+using namespace std;
+
+namespace swlb {
+
+  // Just enough JSON to read back the files this harness writes.
+  class JsonValue {
+  public:
+    enum Kind { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+    Kind kind;
+    bool boolean;
+    double number;
+    string str;
+    vector<JsonValue> items;
+    map<string, JsonValue> fields;
+
+    JsonValue() : kind(JSON_NULL), boolean(false), number(0) {}
+
+    bool has(const string& key) const {
+      return kind == JSON_OBJECT && fields.find(key) != fields.end();
+    }
+
+    const JsonValue& operator[](const string& key) const {
+      static const JsonValue null;
+      auto it = fields.find(key);
+      return it == fields.end() ? null : it->second;
+    }
+  };
+
+  class JsonParser {
+
+    const string& text;
+    size_t pos;
+
+    void skipSpace() {
+      while (pos < text.size() && isspace((unsigned char) text[pos])) {
+        pos++;
+      }
+    }
+
+    bool consume(const char c) {
+      skipSpace();
+      if (pos < text.size() && text[pos] == c) {
+        pos++;
+        return true;
+      }
+      return false;
+    }
+
+    bool parseString(string& out) {
+      if (!consume('"')) {
+        return false;
+      }
+
+      while (pos < text.size() && text[pos] != '"') {
+        if (text[pos] == '\\' && pos + 1 < text.size()) {
+          pos++;
+        }
+        out.push_back(text[pos]);
+        pos++;
+      }
+
+      return consume('"');
+    }
+
+  public:
+
+    JsonParser(const string& text_) : text(text_), pos(0) {}
+
+    bool parse(JsonValue& value) {
+      skipSpace();
+      if (pos >= text.size()) {
+        return false;
+      }
+
+      char c = text[pos];
+      if (c == '{') {
+        pos++;
+        value.kind = JsonValue::JSON_OBJECT;
+        if (consume('}')) {
+          return true;
+        }
+        do {
+          string key;
+          JsonValue field;
+          if (!parseString(key) || !consume(':') || !parse(field)) {
+            return false;
+          }
+          value.fields[key] = field;
+        } while (consume(','));
+        return consume('}');
+      }
+
+      if (c == '[') {
+        pos++;
+        value.kind = JsonValue::JSON_ARRAY;
+        if (consume(']')) {
+          return true;
+        }
+        do {
+          JsonValue item;
+          if (!parse(item)) {
+            return false;
+          }
+          value.items.push_back(item);
+        } while (consume(','));
+        return consume(']');
+      }
+
+      if (c == '"') {
+        value.kind = JsonValue::JSON_STRING;
+        return parseString(value.str);
+      }
+
+      if (text.compare(pos, 4, "null") == 0) {
+        pos += 4;
+        value.kind = JsonValue::JSON_NULL;
+        return true;
+      }
+
+      if (text.compare(pos, 4, "true") == 0 || text.compare(pos, 5, "false") == 0) {
+        value.kind = JsonValue::JSON_BOOL;
+        value.boolean = text[pos] == 't';
+        pos += value.boolean ? 4 : 5;
+        return true;
+      }
+
+      const char* start = text.c_str() + pos;
+      char* end = nullptr;
+      value.kind = JsonValue::JSON_NUMBER;
+      value.number = strtod(start, &end);
+      if (end == start) {
+        return false;
+      }
+      pos += end - start;
+      return true;
+    }
+  };
+
+  static inline
+  bool parseJson(const string& text, JsonValue& value) {
+    JsonParser parser(text);
+    return parser.parse(value);
+  }
+
+  // The per configuration numbers a baseline keeps for one engine.
+  class BaselineEntry {
+  public:
+    string key;
+    int reps;
+    double median;
+    double mean;
+    double stddev;
+    double countersPerPixel[NUM_PERF_EVENTS];
+
+    BaselineEntry() : reps(0), median(0), mean(0), stddev(0) {
+      for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+        countersPerPixel[e] = -1;
+      }
+    }
+  };
+
+  static inline
+  string baselineKey(const BenchResult& r) {
+    return r.engine + "/" + r.elemType + "/" + r.size + "/" + to_string(r.kernel) + "x" + to_string(r.kernel);
+  }
+
+  static inline
+  BaselineEntry baselineEntry(const BenchResult& r) {
+    BaselineEntry entry;
+    SampleStats s = r.stats();
+    entry.key = baselineKey(r);
+    entry.reps = r.nsPerPixel.size();
+    entry.median = s.median;
+    entry.mean = s.mean;
+    entry.stddev = s.stddev;
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      entry.countersPerPixel[e] = r.countersPerPixel[e];
+    }
+    return entry;
+  }
+
+  typedef map<string, BaselineEntry> Baseline;
+
+  // A baseline file maps baseline names to their entries:
+  //   {"name": {"engine/type/size/KxK": {"reps": .., "median_ns_per_pixel": .., ...}}}
+  static inline
+  bool loadBaselines(const string& path, map<string, Baseline>& baselines) {
+    ifstream in(path);
+    if (!in) {
+      return false;
+    }
+
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    JsonValue root;
+    if (!parseJson(text, root) || root.kind != JsonValue::JSON_OBJECT) {
+      return false;
+    }
+
+    for (auto& named : root.fields) {
+      Baseline& baseline = baselines[named.first];
+      for (auto& field : named.second.fields) {
+        const JsonValue& v = field.second;
+        BaselineEntry entry;
+        entry.key = field.first;
+        entry.reps = v["reps"].number;
+        entry.median = v["median_ns_per_pixel"].number;
+        entry.mean = v["mean_ns_per_pixel"].number;
+        entry.stddev = v["stddev_ns_per_pixel"].number;
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+          const JsonValue& c = v["counters_per_output_pixel"][perfEventName((PerfEvent) e)];
+          entry.countersPerPixel[e] = c.kind == JsonValue::JSON_NUMBER ? c.number : -1;
+        }
+        baseline[entry.key] = entry;
+      }
+    }
+
+    return true;
+  }
+
+  static inline
+  bool saveBaselines(const string& path, const map<string, Baseline>& baselines) {
+    ofstream out(path);
+    if (!out) {
+      return false;
+    }
+
+    out.precision(10);
+    out << "{" << endl;
+    size_t n = 0;
+    for (auto& named : baselines) {
+      out << "  \"" << named.first << "\": {" << endl;
+      size_t m = 0;
+      for (auto& entry : named.second) {
+        const BaselineEntry& b = entry.second;
+        out << "    \"" << b.key << "\": {"
+            << "\"reps\": " << b.reps
+            << ", \"median_ns_per_pixel\": " << b.median
+            << ", \"mean_ns_per_pixel\": " << b.mean
+            << ", \"stddev_ns_per_pixel\": " << b.stddev
+            << ", \"counters_per_output_pixel\": ";
+        printCountersJson(out, b.countersPerPixel);
+        out << "}" << (++m == named.second.size() ? "" : ",") << endl;
+      }
+      out << "  }" << (++n == baselines.size() ? "" : ",") << endl;
+    }
+    out << "}" << endl;
+
+    return (bool) out;
+  }
+
+  // Adds or replaces the named baseline in path, keeping any others.
+  static inline
+  bool saveBaseline(const string& path, const string& name, const vector<BenchResult>& results) {
+    map<string, Baseline> baselines;
+    loadBaselines(path, baselines);
+
+    Baseline& baseline = baselines[name];
+    baseline.clear();
+    for (auto& r : results) {
+      BaselineEntry entry = baselineEntry(r);
+      baseline[entry.key] = entry;
+    }
+
+    return saveBaselines(path, baselines);
+  }
+
+  // One sided 95% critical value of Student's t with df degrees of
+  // freedom.
+  static inline
+  double tCritical95(const double df) {
+    const double table[] = {
+      6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833, 1.812,
+      1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734, 1.729, 1.725,
+      1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703, 1.701, 1.699, 1.697
+    };
+
+    if (df < 1) {
+      return table[0];
+    }
+    if (df <= 30) {
+      return table[(int) df - 1];
+    }
+    return 1.645 + (1.697 - 1.645)*30.0 / df;
+  }
+
+  enum ComparisonVerdict {
+    VERDICT_UNCHANGED,
+    VERDICT_REGRESSION,
+    VERDICT_IMPROVEMENT,
+    VERDICT_TOO_FEW_REPS,
+    VERDICT_NEW
+  };
+
+  class BaselineComparison {
+  public:
+    string key;
+    ComparisonVerdict verdict;
+    double baselineMedian;
+    double currentMedian;
+    double t;
+
+    BaselineComparison() : verdict(VERDICT_NEW), baselineMedian(0), currentMedian(0), t(0) {}
+
+    double percentChange() const {
+      return baselineMedian > 0 ? 100.0*(currentMedian - baselineMedian) / baselineMedian : 0;
+    }
+  };
+
+  // Welch's t-test on the repetition means: a change is only significant
+  // when it is large relative to the run to run variance of both runs, so
+  // noisy configurations need a bigger change to be flagged than quiet
+  // ones.
+  static inline
+  BaselineComparison compareToBaseline(const BaselineEntry& base, const BenchResult& current) {
+    BaselineComparison c;
+    SampleStats s = current.stats();
+    int n = current.nsPerPixel.size();
+
+    c.key = base.key;
+    c.baselineMedian = base.median;
+    c.currentMedian = s.median;
+
+    if (base.reps < 2 || n < 2) {
+      c.verdict = VERDICT_TOO_FEW_REPS;
+      return c;
+    }
+
+    double va = base.stddev*base.stddev / base.reps;
+    double vb = s.stddev*s.stddev / n;
+    double diff = s.mean - base.mean;
+
+    if (va + vb == 0) {
+      c.t = diff == 0 ? 0 : (diff > 0 ? 1e9 : -1e9);
+      c.verdict = diff == 0 ? VERDICT_UNCHANGED : (diff > 0 ? VERDICT_REGRESSION : VERDICT_IMPROVEMENT);
+      return c;
+    }
+
+    c.t = diff / sqrt(va + vb);
+    double df = (va + vb)*(va + vb) /
+      (va*va / (base.reps - 1) + vb*vb / (n - 1));
+
+    double critical = tCritical95(df);
+    if (c.t > critical) {
+      c.verdict = VERDICT_REGRESSION;
+    } else if (c.t < -critical) {
+      c.verdict = VERDICT_IMPROVEMENT;
+    } else {
+      c.verdict = VERDICT_UNCHANGED;
+    }
+
+    return c;
+  }
+
+  // Prints one line per configuration and returns the number of
+  // significant regressions.
+  static inline
+  int reportComparison(ostream& out, const Baseline& baseline, const vector<BenchResult>& results) {
+    const char* verdicts[] = {"unchanged", "REGRESSION", "improved", "too few reps", "new"};
+
+    int regressions = 0;
+    for (auto& r : results) {
+      BaselineComparison c;
+      c.key = baselineKey(r);
+      c.currentMedian = r.stats().median;
+
+      auto it = baseline.find(c.key);
+      if (it != baseline.end()) {
+        c = compareToBaseline(it->second, r);
+      }
+
+      if (c.verdict == VERDICT_REGRESSION) {
+        regressions++;
+      }
+
+      out << c.key << ": " << verdicts[c.verdict];
+      if (c.verdict != VERDICT_NEW) {
+        out << " " << c.baselineMedian << " -> " << c.currentMedian << " ns/pixel ("
+            << (c.percentChange() >= 0 ? "+" : "") << c.percentChange() << "%, t = " << c.t << ")";
+
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+          double before = it->second.countersPerPixel[e];
+          double after = r.countersPerPixel[e];
+          if (before > 0 && after >= 0) {
+            out << " " << perfEventName((PerfEvent) e) << " "
+                << (after >= before ? "+" : "") << 100.0*(after - before) / before << "%";
+          }
+        }
+      }
+      out << endl;
+    }
+
+    return regressions;
+  }
+
+}
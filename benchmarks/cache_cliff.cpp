@@ -0,0 +1,77 @@
+#include "parallel.h"
+
+#include <chrono>
+#include <memory>
+
+using namespace std;
+using namespace swlb;
+
+const int NROWS = 96;
+const int KSIZE = 7;
+const int REPS = 3;
+
+template<int NumImageCols>
+void measureWidth(ThreadPool& pool) {
+  const int OUT_ROWS = NROWS - 2*(KSIZE / 2);
+  const int OUT_COLS = NumImageCols - 2*(KSIZE / 2);
+
+  unique_ptr<Mem2D<int, NROWS, NumImageCols> > input(new Mem2D<int, NROWS, NumImageCols>());
+  for (int i = 0; i < NROWS; i++) {
+    for (int j = 0; j < NumImageCols; j++) {
+      input->set(i, j, (i*NumImageCols + j) % 251);
+    }
+  }
+
+  Mem2D<int, KSIZE, KSIZE> kernel;
+  for (int i = 0; i < KSIZE; i++) {
+    for (int j = 0; j < KSIZE; j++) {
+      kernel.set(i, j, i - j);
+    }
+  }
+
+  unique_ptr<Mem2D<int, OUT_ROWS, OUT_COLS> > output(new Mem2D<int, OUT_ROWS, OUT_COLS>());
+
+  StripPlanner planners[] = {StripPlanner::fullWidth(), StripPlanner::host()};
+  const char* names[] = {"off", "on"};
+
+  for (int p = 0; p < 2; p++) {
+    double bestMs = 0;
+    for (int rep = 0; rep < REPS; rep++) {
+      auto start = chrono::steady_clock::now();
+      lineBufferConvParallel(*input, kernel, *output, pool, 0, planners[p]);
+      auto end = chrono::steady_clock::now();
+
+      double ms = chrono::duration<double, milli>(end - start).count();
+      if (rep == 0 || ms < bestMs) {
+        bestMs = ms;
+      }
+    }
+
+    int stripCols = planners[p].stripCols(sizeof(int), KSIZE, KSIZE, OUT_COLS);
+    cout << NumImageCols << ","
+         << tileWorkingSetBytes(sizeof(int), KSIZE, KSIZE, OUT_COLS) << ","
+         << names[p] << ","
+         << stripCols << ","
+         << bestMs << ","
+         << (double) NROWS*NumImageCols / (bestMs*1000.0) << endl;
+  }
+}
+
+// Sweeps the image width across the L2 size with the cache planner off
+// (full width line buffers) and on, to show the throughput cliff a full
+// width line buffer falls off once it no longer fits in cache.
+int main() {
+  const CacheInfo& cache = hostCacheInfo();
+  cout << "# L1d " << cache.l1dBytes << " L2 " << cache.l2Bytes << " L3 " << cache.l3Bytes << endl;
+  cout << "image_cols,full_width_lb_bytes,planner,strip_cols,best_ms,mpix_per_s" << endl;
+
+  ThreadPool pool(thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1);
+
+  measureWidth<1024>(pool);
+  measureWidth<8192>(pool);
+  measureWidth<32768>(pool);
+  measureWidth<65536>(pool);
+  measureWidth<131072>(pool);
+
+  return 0;
+}
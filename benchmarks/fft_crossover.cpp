@@ -0,0 +1,143 @@
+#include "fft_conv.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace swlb;
+
+const int NROWS = 1080;
+const int NCOLS = 1920;
+const int REPS = 2;
+
+class VectorSource {
+
+  const vector<int>& pixels;
+  size_t next;
+
+public:
+
+  VectorSource(const vector<int>& pixels_) : pixels(pixels_), next(0) {}
+
+  int read() const {
+    return pixels[next];
+  }
+
+  void pop() {
+    next++;
+  }
+
+  bool isEmpty() const {
+    return next == pixels.size();
+  }
+};
+
+// Sums the output so the compiler cannot drop the convolution.
+class SumSink {
+public:
+  long sum;
+
+  SumSink() : sum(0) {}
+
+  void write(const int value) {
+    sum += value;
+  }
+};
+
+// f is called through a std::function: inlined, the direct engine reads
+// nothing the clock calls could change and gets moved out of the timed
+// region.
+double bestOf(const int reps, const function<void()>& f) {
+  double bestMs = 0;
+  for (int rep = 0; rep < reps; rep++) {
+    auto start = chrono::steady_clock::now();
+    f();
+    auto end = chrono::steady_clock::now();
+
+    double ms = chrono::duration<double, milli>(end - start).count();
+    if (rep == 0 || ms < bestMs) {
+      bestMs = ms;
+    }
+  }
+  return bestMs;
+}
+
+void report(const char* engine, const int kernelSize, const double ms, const long sum) {
+  cout << engine << "," << kernelSize << "," << ms << ","
+       << 1e6*ms / ((double) NROWS*NCOLS) << "," << sum << endl;
+}
+
+// Times the direct and FFT engines for one kernel size and returns
+// whether the FFT engine won.
+template<int KernelSize>
+bool benchKernel(const vector<int>& image) {
+  Mem2D<int, KernelSize, KernelSize> kernel;
+  for (int i = 0; i < KernelSize; i++) {
+    for (int j = 0; j < KernelSize; j++) {
+      kernel.set(i, j, (i*KernelSize + j) % 7 + 1);
+    }
+  }
+
+  long directSum = 0;
+  double directMs = bestOf(REPS, [&]() {
+      VectorSource source(image);
+      SumSink sink;
+      lineBufferConvStream<int, KernelSize, KernelSize, NROWS, NCOLS>(source, kernel, sink);
+      directSum = sink.sum;
+    });
+  report("direct", KernelSize, directMs, directSum);
+
+  long fftSum = 0;
+  double fftMs = bestOf(REPS, [&]() {
+      VectorSource source(image);
+      SumSink sink;
+      lineBufferConvFFT<int, KernelSize, KernelSize, NROWS, NCOLS>(source, kernel, sink);
+      fftSum = sink.sum;
+    });
+  report("fft", KernelSize, fftMs, fftSum);
+
+  return fftMs < directMs;
+}
+
+// Compares lineBufferConvStream against lineBufferConvFFT on a 1080p
+// frame for growing square kernels and reports the smallest kernel from
+// which the FFT engine is faster. The direct engine's cost grows with the
+// kernel area while the FFT engine's barely moves. The checksum column
+// must agree between the two engines for the same kernel.
+int main() {
+  vector<int> image(NROWS*NCOLS);
+  unsigned state = 1;
+  for (int i = 0; i < NROWS*NCOLS; i++) {
+    state = state*1103515245 + 12345;
+    image[i] = (state >> 8) % 256;
+  }
+
+  cout << "engine,kernel,best_ms,ns_per_pixel,checksum" << endl;
+
+  const int sizes[] = {3, 5, 7, 9, 11, 15, 21, 31};
+  const bool fftWins[] = {
+    benchKernel<3>(image),
+    benchKernel<5>(image),
+    benchKernel<7>(image),
+    benchKernel<9>(image),
+    benchKernel<11>(image),
+    benchKernel<15>(image),
+    benchKernel<21>(image),
+    benchKernel<31>(image)
+  };
+
+  const int numSizes = sizeof(sizes) / sizeof(sizes[0]);
+  int crossover = numSizes;
+  while (crossover > 0 && fftWins[crossover - 1]) {
+    crossover--;
+  }
+
+  if (crossover == numSizes) {
+    cerr << "The FFT engine did not win up to " << sizes[numSizes - 1] << "x" << sizes[numSizes - 1] << endl;
+  } else {
+    cerr << "The FFT engine wins from " << sizes[crossover] << "x" << sizes[crossover] << " up" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,453 @@
+#pragma once
+
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace swlb {
+
+  class SampleStats {
+  public:
+    double min;
+    double max;
+    double mean;
+    double stddev;
+    double median;
+    double p10;
+    double p90;
+
+    SampleStats() : min(0), max(0), mean(0), stddev(0), median(0), p10(0), p90(0) {}
+  };
+
+  // Linear interpolation between closest ranks of the sorted samples.
+  static inline
+  double percentile(const vector<double>& sorted, const double p) {
+    if (sorted.empty()) {
+      return 0;
+    }
+
+    double rank = p*(sorted.size() - 1);
+    int lo = (int) floor(rank);
+    int hi = (int) ceil(rank);
+    return sorted[lo] + (rank - lo)*(sorted[hi] - sorted[lo]);
+  }
+
+  static inline
+  SampleStats computeStats(vector<double> samples) {
+    SampleStats stats;
+    if (samples.empty()) {
+      return stats;
+    }
+
+    sort(samples.begin(), samples.end());
+
+    double sum = 0;
+    for (auto s : samples) {
+      sum += s;
+    }
+    stats.mean = sum / samples.size();
+
+    double sq = 0;
+    for (auto s : samples) {
+      sq += (s - stats.mean)*(s - stats.mean);
+    }
+    stats.stddev = samples.size() > 1 ? sqrt(sq / (samples.size() - 1)) : 0;
+
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = percentile(samples, 0.5);
+    stats.p10 = percentile(samples, 0.1);
+    stats.p90 = percentile(samples, 0.9);
+
+    return stats;
+  }
+
+  // Peak resident set size of this process so far.
+  static inline
+  long peakRssBytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss*1024L;
+  }
+
+  // One engine run on one configuration. Times are per input pixel.
+  // bytesPerPixel is the engine's working set (input, output and any
+  // intermediate FIFOs or line buffers) divided by the input pixel count.
+  // Hardware counters are averaged over the measured repetitions and
+  // divided by the output pixel count, -1 where a counter is unavailable.
+  class BenchResult {
+  public:
+    string engine;
+    string elemType;
+    string size;
+    int rows;
+    int cols;
+    int kernel;
+    int warmup;
+
+    vector<double> nsPerPixel;
+    double bytesPerPixel;
+    long peakRss;
+    double countersPerPixel[NUM_PERF_EVENTS];
+
+    BenchResult() : rows(0), cols(0), kernel(0), warmup(0), bytesPerPixel(0), peakRss(0) {
+      for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        countersPerPixel[i] = -1;
+      }
+    }
+
+    SampleStats stats() const {
+      return computeStats(nsPerPixel);
+    }
+
+    double mpixPerSecond() const {
+      double median = stats().median;
+      return median > 0 ? 1000.0 / median : 0;
+    }
+  };
+
+  static inline
+  vector<string> splitList(const string& str) {
+    vector<string> items;
+    stringstream in(str);
+    string item;
+    while (getline(in, item, ',')) {
+      if (!item.empty()) {
+        items.push_back(item);
+      }
+    }
+    return items;
+  }
+
+  class BenchOptions {
+  public:
+    vector<string> sizes;
+    vector<int> kernels;
+    vector<string> types;
+    vector<string> engines;
+
+    int reps;
+    int warmup;
+    int threads;
+    bool fork;
+    bool counters;
+    bool footprint;
+    string format;
+
+    string baselineFile;
+    string saveBaseline;
+    string compareBaseline;
+
+    BenchOptions() :
+      reps(5), warmup(1), threads(1), fork(true), counters(true), footprint(false), format("json"),
+      baselineFile("swlb-baseline.json") {
+      sizes = splitList("vga,720p,1080p,4k,8k");
+      kernels = {3, 5, 7, 9, 11, 13, 15};
+      types = splitList("int16,int32");
+
+      long n = sysconf(_SC_NPROCESSORS_ONLN);
+      threads = n > 0 ? n : 1;
+    }
+
+    bool wantsSize(const string& s) const {
+      return find(sizes.begin(), sizes.end(), s) != sizes.end();
+    }
+
+    bool wantsKernel(const int k) const {
+      return find(kernels.begin(), kernels.end(), k) != kernels.end();
+    }
+
+    bool wantsType(const string& t) const {
+      return find(types.begin(), types.end(), t) != types.end();
+    }
+
+    // An empty engine list selects every engine.
+    bool wantsEngine(const string& e) const {
+      return engines.empty() || find(engines.begin(), engines.end(), e) != engines.end();
+    }
+
+    // Parses --name=value arguments. Returns false and prints the problem
+    // on anything it does not recognise.
+    bool parse(const int argc, char** argv) {
+      for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string name = arg.substr(0, eq);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+
+        if (name == "--sizes") {
+          sizes = splitList(value);
+        } else if (name == "--kernels") {
+          kernels.clear();
+          for (auto& k : splitList(value)) {
+            kernels.push_back(atoi(k.c_str()));
+          }
+        } else if (name == "--types") {
+          types = splitList(value);
+        } else if (name == "--engines") {
+          engines = splitList(value);
+        } else if (name == "--reps") {
+          reps = atoi(value.c_str());
+        } else if (name == "--warmup") {
+          warmup = atoi(value.c_str());
+        } else if (name == "--threads") {
+          threads = atoi(value.c_str());
+        } else if (name == "--format") {
+          format = value;
+        } else if (name == "--no-fork") {
+          fork = false;
+        } else if (name == "--no-counters") {
+          counters = false;
+        } else if (name == "--footprint") {
+          footprint = true;
+        } else if (name == "--baseline-file") {
+          baselineFile = value;
+        } else if (name == "--save-baseline") {
+          saveBaseline = value;
+        } else if (name == "--compare") {
+          compareBaseline = value;
+        } else {
+          cerr << "Unknown option " << arg << endl;
+          return false;
+        }
+      }
+
+      if (reps < 1 || warmup < 0 || threads < 1 ||
+          (format != "json" && format != "csv")) {
+        cerr << "Bad option value" << endl;
+        return false;
+      }
+
+      return true;
+    }
+  };
+
+  // Runs setup (untimed) and then run, warmup times without recording and
+  // reps times recording ns per input pixel into result. If counters is
+  // given they are enabled around each measured run only.
+  static inline
+  void timeRuns(const int warmup,
+                const int reps,
+                const long pixels,
+                const long outputPixels,
+                const function<void()>& setup,
+                const function<void()>& run,
+                PerfCounters* counters,
+                BenchResult& result) {
+    double totals[NUM_PERF_EVENTS];
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      totals[e] = 0;
+    }
+
+    result.nsPerPixel.clear();
+    for (int i = 0; i < warmup + reps; i++) {
+      setup();
+
+      bool measured = i >= warmup;
+      if (measured && counters != nullptr) {
+        counters->start();
+      }
+
+      auto start = chrono::steady_clock::now();
+      run();
+      auto end = chrono::steady_clock::now();
+
+      if (measured && counters != nullptr) {
+        counters->stop();
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+          double count = counters->read((PerfEvent) e);
+          totals[e] = (count < 0 || totals[e] < 0) ? -1 : totals[e] + count;
+        }
+      }
+
+      if (measured) {
+        double ns = chrono::duration<double, nano>(end - start).count();
+        result.nsPerPixel.push_back(ns / pixels);
+      }
+    }
+
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      result.countersPerPixel[e] = (counters == nullptr || totals[e] < 0) ?
+        -1 :
+        totals[e] / ((double) reps*outputPixels);
+    }
+  }
+
+  // Runs bench in a forked child so that its peak RSS is its own, and so
+  // an 8K configuration's buffers are returned to the system before the
+  // next one starts. Only the measurements come back from the child, the
+  // caller fills in the identifying fields. Falls back to running in
+  // process.
+  static inline
+  BenchResult runIsolated(const bool isolate, const function<BenchResult()>& bench) {
+    int fds[2];
+    if (!isolate || pipe(fds) != 0) {
+      return bench();
+    }
+
+    pid_t pid = ::fork();
+    if (pid < 0) {
+      close(fds[0]);
+      close(fds[1]);
+      return bench();
+    }
+
+    if (pid == 0) {
+      close(fds[0]);
+      BenchResult res = bench();
+
+      ostringstream out;
+      out.precision(17);
+      out << res.bytesPerPixel << " " << res.peakRss;
+      for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+        out << " " << res.countersPerPixel[e];
+      }
+      out << " " << res.nsPerPixel.size();
+      for (auto ns : res.nsPerPixel) {
+        out << " " << ns;
+      }
+
+      string msg = out.str();
+      size_t written = 0;
+      while (written < msg.size()) {
+        ssize_t n = write(fds[1], msg.data() + written, msg.size() - written);
+        if (n <= 0) {
+          break;
+        }
+        written += n;
+      }
+      close(fds[1]);
+      _exit(0);
+    }
+
+    close(fds[1]);
+    string msg;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+      msg.append(buf, n);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    BenchResult res;
+    istringstream in(msg);
+    size_t count = 0;
+    in >> res.bytesPerPixel >> res.peakRss;
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      in >> res.countersPerPixel[e];
+    }
+    in >> count;
+    for (size_t i = 0; i < count; i++) {
+      double ns = 0;
+      in >> ns;
+      res.nsPerPixel.push_back(ns);
+    }
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || count == 0) {
+      cerr << "Benchmark child failed" << endl;
+    }
+
+    return res;
+  }
+
+  static inline
+  void printStatsJson(ostream& out, const SampleStats& s) {
+    out << "{\"median\": " << s.median
+        << ", \"p10\": " << s.p10
+        << ", \"p90\": " << s.p90
+        << ", \"mean\": " << s.mean
+        << ", \"stddev\": " << s.stddev
+        << ", \"min\": " << s.min
+        << ", \"max\": " << s.max << "}";
+  }
+
+  static inline
+  void printCountersJson(ostream& out, const double* countersPerPixel) {
+    out << "{";
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      out << (e == 0 ? "" : ", ") << "\"" << perfEventName((PerfEvent) e) << "\": ";
+      if (countersPerPixel[e] < 0) {
+        out << "null";
+      } else {
+        out << countersPerPixel[e];
+      }
+    }
+    out << "}";
+  }
+
+  static inline
+  void printJson(ostream& out, const vector<BenchResult>& results) {
+    out << "[" << endl;
+    for (size_t i = 0; i < results.size(); i++) {
+      const BenchResult& r = results[i];
+      out << "  {\"engine\": \"" << r.engine << "\""
+          << ", \"type\": \"" << r.elemType << "\""
+          << ", \"size\": \"" << r.size << "\""
+          << ", \"rows\": " << r.rows
+          << ", \"cols\": " << r.cols
+          << ", \"kernel\": " << r.kernel
+          << ", \"warmup\": " << r.warmup
+          << ", \"reps\": " << r.nsPerPixel.size()
+          << ", \"ns_per_pixel\": ";
+      printStatsJson(out, r.stats());
+      out << ", \"samples\": [";
+      for (size_t j = 0; j < r.nsPerPixel.size(); j++) {
+        out << (j == 0 ? "" : ", ") << r.nsPerPixel[j];
+      }
+      out << "]"
+          << ", \"mpix_per_s\": " << r.mpixPerSecond()
+          << ", \"bytes_per_pixel\": " << r.bytesPerPixel
+          << ", \"peak_rss_bytes\": " << r.peakRss
+          << ", \"counters_per_output_pixel\": ";
+      printCountersJson(out, r.countersPerPixel);
+      out << "}" << (i + 1 == results.size() ? "" : ",") << endl;
+    }
+    out << "]" << endl;
+  }
+
+  static inline
+  void printCsv(ostream& out, const vector<BenchResult>& results) {
+    out << "engine,type,size,rows,cols,kernel,warmup,reps,"
+        << "ns_per_pixel_median,ns_per_pixel_p10,ns_per_pixel_p90,ns_per_pixel_mean,ns_per_pixel_stddev,"
+        << "mpix_per_s,bytes_per_pixel,peak_rss_bytes";
+    for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+      out << "," << perfEventName((PerfEvent) e) << "_per_output_pixel";
+    }
+    out << endl;
+
+    for (auto& r : results) {
+      SampleStats s = r.stats();
+      out << r.engine << "," << r.elemType << "," << r.size << ","
+          << r.rows << "," << r.cols << "," << r.kernel << ","
+          << r.warmup << "," << r.nsPerPixel.size() << ","
+          << s.median << "," << s.p10 << "," << s.p90 << "," << s.mean << "," << s.stddev << ","
+          << r.mpixPerSecond() << "," << r.bytesPerPixel << "," << r.peakRss;
+      for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+        out << ",";
+        if (r.countersPerPixel[e] >= 0) {
+          out << r.countersPerPixel[e];
+        }
+      }
+      out << endl;
+    }
+  }
+
+}
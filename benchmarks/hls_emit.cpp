@@ -0,0 +1,40 @@
+#include "example_vectors.h"
+#include "hls_emit.h"
+
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+using namespace swlb;
+
+template<int K>
+bool emit(const string& dir, const string& name, const Mem2D<int, K, K>& kernel) {
+  const HlsConvConfig config = hlsConvConfig<int, K, K, NROWS, NCOLS>(name, "int", kernel);
+
+  ofstream conv(dir + "/" + name + ".cpp");
+  emitHlsConv(conv, config);
+
+  ofstream tb(dir + "/" + name + "_tb.cpp");
+  emitHlsTestbench(tb, config, exampleInput(), kernel);
+
+  return conv && tb;
+}
+
+// Writes HLS C++ for the 3x3 and 5x5 convolutions of test/lb.cpp, with a
+// C simulation testbench for each, into the given directory:
+//   conv3x3.cpp conv3x3_tb.cpp conv5x5.cpp conv5x5_tb.cpp
+// The build compiles and runs the testbenches, and the same files go
+// straight into an HLS project.
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    cerr << "usage: swlb-hls <output directory>" << endl;
+    return 1;
+  }
+  const string dir = argv[1];
+
+  if (!emit(dir, "conv3x3", exampleKernel()) || !emit(dir, "conv5x5", exampleKernel5x5())) {
+    cerr << "Could not write to " << dir << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include "median.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace swlb;
+
+const int NROWS = 480;
+const int NCOLS = 640;
+const int REPS = 3;
+
+template<typename ElemType>
+class VectorSource {
+
+  const vector<ElemType>& pixels;
+  size_t next;
+
+public:
+
+  VectorSource(const vector<ElemType>& pixels_) : pixels(pixels_), next(0) {}
+
+  ElemType read() const {
+    return pixels[next];
+  }
+
+  void pop() {
+    next++;
+  }
+
+  bool isEmpty() const {
+    return next == pixels.size();
+  }
+};
+
+// Sums the output so the compiler cannot drop the filter.
+class SumSink {
+public:
+  long sum;
+
+  SumSink() : sum(0) {}
+
+  void write(const int value) {
+    sum += value;
+  }
+};
+
+template<typename F>
+double bestOf(const int reps, F f) {
+  double bestMs = 0;
+  for (int rep = 0; rep < reps; rep++) {
+    auto start = chrono::steady_clock::now();
+    f();
+    auto end = chrono::steady_clock::now();
+
+    double ms = chrono::duration<double, milli>(end - start).count();
+    if (rep == 0 || ms < bestMs) {
+      bestMs = ms;
+    }
+  }
+  return bestMs;
+}
+
+template<typename ElemType>
+void report(const char* engine, const int kernelSize, const double ms, const long sum) {
+  cout << engine << "," << 8*sizeof(ElemType) << "," << kernelSize << "," << ms << ","
+       << 1e6*ms / ((double) NROWS*NCOLS) << "," << sum << endl;
+}
+
+template<typename ElemType, int KernelSize>
+void benchHistogram(const vector<ElemType>& image) {
+  long sum = 0;
+  double ms = bestOf(REPS, [&]() {
+      VectorSource<ElemType> source(image);
+      SumSink sink;
+      lineBufferMedianHistogram<ElemType, KernelSize, NROWS, NCOLS>(source, sink);
+      sum = sink.sum;
+    });
+  report<ElemType>("histogram", KernelSize, ms, sum);
+}
+
+template<typename ElemType, int KernelSize>
+void benchNaive(const vector<ElemType>& image) {
+  long sum = 0;
+  double ms = bestOf(REPS, [&]() {
+      VectorSource<ElemType> source(image);
+      SumSink sink;
+      lineBufferMedianNaive<ElemType, KernelSize, NROWS, NCOLS>(source, sink);
+      sum = sink.sum;
+    });
+  report<ElemType>("naive", KernelSize, ms, sum);
+}
+
+template<typename ElemType, int KernelSize>
+void benchNetwork(const vector<ElemType>& image) {
+  long sum = 0;
+  double ms = bestOf(REPS, [&]() {
+      VectorSource<ElemType> source(image);
+      SumSink sink;
+      lineBufferMedianNetwork<ElemType, KernelSize, NROWS, NCOLS>(source, sink);
+      sum = sink.sum;
+    });
+  report<ElemType>("network", KernelSize, ms, sum);
+}
+
+template<typename ElemType, int KernelSize>
+void benchAll(const vector<ElemType>& image) {
+  benchNaive<ElemType, KernelSize>(image);
+  benchHistogram<ElemType, KernelSize>(image);
+}
+
+template<typename ElemType>
+void benchDepth(const int maxValue) {
+  vector<ElemType> image(NROWS*NCOLS);
+  unsigned state = 1;
+  for (int i = 0; i < NROWS*NCOLS; i++) {
+    state = state*1103515245 + 12345;
+    image[i] = (state >> 8) % (maxValue + 1);
+  }
+
+  benchAll<ElemType, 3>(image);
+  benchNetwork<ElemType, 3>(image);
+  benchAll<ElemType, 5>(image);
+  benchNetwork<ElemType, 5>(image);
+  benchAll<ElemType, 7>(image);
+  benchAll<ElemType, 11>(image);
+  benchAll<ElemType, 15>(image);
+  benchAll<ElemType, 21>(image);
+  benchHistogram<ElemType, 31>(image);
+  benchHistogram<ElemType, 51>(image);
+}
+
+// Compares the median engines on a VGA frame of noise for growing window
+// sizes: the naive engine's cost per pixel grows with the window area, the
+// histogram engine's stays nearly flat, and the selection networks are the
+// fastest for 3x3 and 5x5. The checksum column must agree between engines
+// for the same depth and window.
+int main() {
+  cout << "engine,bits,kernel,best_ms,ns_per_pixel,checksum" << endl;
+  benchDepth<uint8_t>(255);
+  benchDepth<uint16_t>(4095);
+  return 0;
+}
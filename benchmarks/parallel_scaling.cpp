@@ -0,0 +1,114 @@
+#include "parallel.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+
+using namespace std;
+using namespace swlb;
+
+template<typename F>
+double bestOf(const int reps, F f) {
+  double bestMs = 0;
+  for (int rep = 0; rep < reps; rep++) {
+    auto start = chrono::steady_clock::now();
+    f();
+    auto end = chrono::steady_clock::now();
+
+    double ms = chrono::duration<double, milli>(end - start).count();
+    if (rep == 0 || ms < bestMs) {
+      bestMs = ms;
+    }
+  }
+  return bestMs;
+}
+
+// Strips versus cache sized tiles on a 16k wide image, where a full width
+// line buffer no longer fits in L2.
+void wideImageComparison(const int maxThreads) {
+  const int NROWS = 256;
+  const int NCOLS = 16384;
+  const int KSIZE = 5;
+  const int OUT_ROWS = NROWS - 2*(KSIZE / 2);
+  const int OUT_COLS = NCOLS - 2*(KSIZE / 2);
+  const int REPS = 3;
+
+  unique_ptr<Mem2D<int, NROWS, NCOLS> > input(new Mem2D<int, NROWS, NCOLS>());
+  for (int i = 0; i < NROWS; i++) {
+    for (int j = 0; j < NCOLS; j++) {
+      input->set(i, j, (i*NCOLS + j) % 251);
+    }
+  }
+
+  Mem2D<int, KSIZE, KSIZE> kernel;
+  for (int i = 0; i < KSIZE; i++) {
+    for (int j = 0; j < KSIZE; j++) {
+      kernel.set(i, j, i + j);
+    }
+  }
+
+  unique_ptr<Mem2D<int, OUT_ROWS, OUT_COLS> > output(new Mem2D<int, OUT_ROWS, OUT_COLS>());
+
+  ThreadPool pool(maxThreads);
+
+  double stripMs = bestOf(REPS, [&]() { lineBufferConvParallel(*input, kernel, *output, pool); });
+  double tileMs = bestOf(REPS, [&]() { lineBufferConvTiled(*input, kernel, *output, pool); });
+
+  cout << endl;
+  cout << "engine,threads,best_ms,mpix_per_s" << endl;
+  cout << "strips," << maxThreads << "," << stripMs << "," << (double) NROWS*NCOLS / (stripMs*1000.0) << endl;
+  cout << "tiles," << maxThreads << "," << tileMs << "," << (double) NROWS*NCOLS / (tileMs*1000.0) << endl;
+}
+
+// Prints the throughput of lineBufferConvParallel on a 1080p frame for
+// every thread count from 1 to the number of hardware threads (or argv[1]),
+// then compares strips against tiles on a very wide image.
+int main(int argc, char** argv) {
+  const int NROWS = 1080;
+  const int NCOLS = 1920;
+  const int KSIZE = 5;
+  const int OUT_ROWS = NROWS - 2*(KSIZE / 2);
+  const int OUT_COLS = NCOLS - 2*(KSIZE / 2);
+  const int REPS = 5;
+
+  int maxThreads = argc > 1 ? atoi(argv[1]) : thread::hardware_concurrency();
+  if (maxThreads < 1) {
+    maxThreads = 1;
+  }
+
+  unique_ptr<Mem2D<int, NROWS, NCOLS> > input(new Mem2D<int, NROWS, NCOLS>());
+  for (int i = 0; i < NROWS; i++) {
+    for (int j = 0; j < NCOLS; j++) {
+      input->set(i, j, (i*NCOLS + j) % 251);
+    }
+  }
+
+  Mem2D<int, KSIZE, KSIZE> kernel;
+  for (int i = 0; i < KSIZE; i++) {
+    for (int j = 0; j < KSIZE; j++) {
+      kernel.set(i, j, i + j);
+    }
+  }
+
+  unique_ptr<Mem2D<int, OUT_ROWS, OUT_COLS> > output(new Mem2D<int, OUT_ROWS, OUT_COLS>());
+
+  cout << "threads,best_ms,mpix_per_s,speedup" << endl;
+
+  double singleThreadMs = 0;
+  for (int threads = 1; threads <= maxThreads; threads++) {
+    ThreadPool pool(threads);
+
+    double bestMs = bestOf(REPS, [&]() { lineBufferConvParallel(*input, kernel, *output, pool); });
+
+    if (threads == 1) {
+      singleThreadMs = bestMs;
+    }
+
+    double mpix = (double) NROWS*NCOLS / (bestMs*1000.0);
+    cout << threads << "," << bestMs << "," << mpix << "," << (singleThreadMs / bestMs) << endl;
+  }
+
+  wideImageComparison(maxThreads);
+
+  return 0;
+}
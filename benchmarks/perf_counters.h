@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace swlb {
+
+  enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_STALLED_FRONTEND,
+    PERF_STALLED_BACKEND,
+    NUM_PERF_EVENTS
+  };
+
+  static inline
+  string perfEventName(const PerfEvent e) {
+    const char* names[NUM_PERF_EVENTS] = {
+      "cycles",
+      "instructions",
+      "l1d_misses",
+      "llc_misses",
+      "branch_misses",
+      "stalled_cycles_frontend",
+      "stalled_cycles_backend"
+    };
+    return names[e];
+  }
+
+  // Hardware counters for this process and any threads it starts after
+  // the counters are opened. Each counter is opened on its own so a PMU
+  // that lacks one event, or a container where perf_event_open is denied
+  // entirely, just leaves those counters unavailable.
+  class PerfCounters {
+
+    int fds[NUM_PERF_EVENTS];
+
+    static int open(const PerfEvent e) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.disabled = 1;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      attr.type = PERF_TYPE_HARDWARE;
+      if (e == PERF_CYCLES) {
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      } else if (e == PERF_INSTRUCTIONS) {
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      } else if (e == PERF_L1D_MISSES) {
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D |
+          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      } else if (e == PERF_LLC_MISSES) {
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      } else if (e == PERF_BRANCH_MISSES) {
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      } else if (e == PERF_STALLED_FRONTEND) {
+        attr.config = PERF_COUNT_HW_STALLED_CYCLES_FRONTEND;
+      } else {
+        attr.config = PERF_COUNT_HW_STALLED_CYCLES_BACKEND;
+      }
+
+      return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+  public:
+
+    PerfCounters() {
+      for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        fds[i] = open((PerfEvent) i);
+      }
+    }
+
+    ~PerfCounters() {
+      for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        if (fds[i] >= 0) {
+          close(fds[i]);
+        }
+      }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available(const PerfEvent e) const {
+      return fds[e] >= 0;
+    }
+
+    bool anyAvailable() const {
+      for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        if (available((PerfEvent) i)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void start() {
+      for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        if (fds[i] >= 0) {
+          ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+          ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+      }
+    }
+
+    void stop() {
+      for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+        if (fds[i] >= 0) {
+          ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+      }
+    }
+
+    // Count since the last start(), scaled up if the kernel had to
+    // multiplex the counter. Returns -1 if the counter is unavailable.
+    double read(const PerfEvent e) const {
+      if (fds[e] < 0) {
+        return -1;
+      }
+
+      unsigned long long values[3] = {0, 0, 0};
+      if (::read(fds[e], values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+        return -1;
+      }
+
+      return (double) values[0]*values[1] / values[2];
+    }
+  };
+
+}
@@ -0,0 +1,707 @@
+#include "baseline.h"
+#include "cache_planner.h"
+#include "demosaic.h"
+#include "fft_conv.h"
+#include "filter_bank.h"
+#include "footprint.h"
+#include "harness.h"
+#include "mapped_frame.h"
+#include "parallel.h"
+#include "pnm.h"
+#include "raw_packed.h"
+#include "static_kernel.h"
+#include "symmetric.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+using namespace std;
+using namespace swlb;
+
+template<typename ElemType>
+class ElemTypeName {};
+
+template<>
+class ElemTypeName<int16_t> {
+public:
+  static string name() { return "int16"; }
+};
+
+template<>
+class ElemTypeName<int32_t> {
+public:
+  static string name() { return "int32"; }
+};
+
+// lineBufferConv3x3 only exists for 3x3 kernels.
+template<typename ElemType, int KernelSize, int NumRows, int NumCols>
+class RegisterWindowEngine {
+public:
+  static const bool available = false;
+
+  static void run(CircularFIFO<ElemType, NumRows*NumCols>&,
+                  const Mem2D<ElemType, KernelSize, KernelSize>&,
+                  CircularFIFO<ElemType, (NumRows - 2*(KernelSize / 2))*(NumCols - 2*(KernelSize / 2))>&) {}
+};
+
+template<typename ElemType, int NumRows, int NumCols>
+class RegisterWindowEngine<ElemType, 3, NumRows, NumCols> {
+public:
+  static const bool available = true;
+
+  static void run(CircularFIFO<ElemType, NumRows*NumCols>& input,
+                  const Mem2D<ElemType, 3, 3>& kernel,
+                  CircularFIFO<ElemType, (NumRows - 2)*(NumCols - 2)>& output) {
+    lineBufferConv3x3<ElemType, NumRows, NumCols>(input, kernel, output);
+  }
+};
+
+// Demosaicing is bilinear with a 3x3 window and Malvar-He-Cutler with a
+// 5x5 one; other kernel sizes have no demosaic engine.
+template<int KernelSize>
+class DemosaicEngine {
+public:
+  static const bool available = false;
+
+  template<int NumRows, int NumCols, typename Source, typename Sink>
+  static void run(Source&, Sink&) {}
+};
+
+template<>
+class DemosaicEngine<3> {
+public:
+  static const bool available = true;
+
+  template<int NumRows, int NumCols, typename Source, typename Sink>
+  static void run(Source& input, Sink& output) {
+    lineBufferDemosaic<3, NumRows, NumCols>(input, bilinearDemosaicKernels(), CFA_RGGB, 1023, output);
+  }
+};
+
+template<>
+class DemosaicEngine<5> {
+public:
+  static const bool available = true;
+
+  template<int NumRows, int NumCols, typename Source, typename Sink>
+  static void run(Source& input, Sink& output) {
+    lineBufferDemosaic<5, NumRows, NumCols>(input, malvarHeCutlerKernels(), CFA_RGGB, 1023, output);
+  }
+};
+
+// A fixed kernel per size for comparing a StaticKernel against the same
+// taps in a runtime Mem2D: Sobel X at 3x3, the binomial blur at 5x5.
+template<int KernelSize>
+class FixedKernel {
+public:
+  static const bool available = false;
+  typedef SobelXKernel Kernel;
+};
+
+template<>
+class FixedKernel<3> {
+public:
+  static const bool available = true;
+  typedef SobelXKernel Kernel;
+};
+
+template<>
+class FixedKernel<5> {
+public:
+  static const bool available = true;
+  typedef Binomial5Kernel Kernel;
+};
+
+// lineBufferConv's multiply-accumulate as a lineBufferStencil functor,
+// to check that the generic engine costs nothing over the hand written
+// one.
+template<typename ElemType, int KernelSize>
+class MacStencil {
+  const Mem2D<ElemType, KernelSize, KernelSize>& kernel;
+
+public:
+  MacStencil(const Mem2D<ElemType, KernelSize, KernelSize>& kernel_) : kernel(kernel_) {}
+
+  template<typename Window>
+  int operator()(const Window& w) const {
+    int res = 0;
+    for (int row = 0; row < KernelSize; row++) {
+      for (int col = 0; col < KernelSize; col++) {
+        res += kernel(row, col)*w.at(row, col);
+      }
+    }
+    return res;
+  }
+};
+
+// Streams a Mem2D frame in row major order without consuming it, so a
+// frame can be read by several passes within one timed run.
+template<typename ElemType, int NumRows, int NumCols>
+class Mem2DSource {
+  const Mem2D<ElemType, NumRows, NumCols>& image;
+  int row;
+  int col;
+
+public:
+  Mem2DSource(const Mem2D<ElemType, NumRows, NumCols>& image_) : image(image_), row(0), col(0) {}
+
+  ElemType read() const {
+    return image(row, col);
+  }
+
+  void pop() {
+    col++;
+    if (col == NumCols) {
+      col = 0;
+      row++;
+    }
+  }
+
+  bool isEmpty() const {
+    return row == NumRows;
+  }
+};
+
+// Folds every output sample into a checksum, for engines whose output
+// does not fit the single channel output FIFO.
+class ChecksumSink {
+public:
+  long sum;
+
+  ChecksumSink() : sum(0) {}
+
+  void write(const int value) {
+    sum += value;
+  }
+};
+
+// A scratch file path unique to this process, under $TMPDIR or /tmp.
+static string benchTempPath(const string& suffix) {
+  const char* dir = getenv("TMPDIR");
+  return string(dir != nullptr ? dir : "/tmp") + "/swlb-bench-" + to_string(getpid()) + suffix;
+}
+
+// The buffers and timing loops for one configuration. Buffers are
+// heap allocated since an 8K frame is far larger than the stack.
+template<typename ElemType, int KernelSize, int NumRows, int NumCols>
+class ConvBench {
+public:
+
+  const static int OUT_ROWS = NumRows - 2*(KernelSize / 2);
+  const static int OUT_COLS = NumCols - 2*(KernelSize / 2);
+  const static long PIXELS = (long) NumRows*NumCols;
+
+  typedef Mem2D<ElemType, NumRows, NumCols> Image;
+  typedef Mem2D<ElemType, OUT_ROWS, OUT_COLS> OutImage;
+  typedef Mem2D<ElemType, KernelSize, KernelSize> Kernel;
+  typedef CircularFIFO<ElemType, NumRows*NumCols> InFIFO;
+  typedef CircularFIFO<ElemType, OUT_ROWS*OUT_COLS> OutFIFO;
+
+  const BenchOptions& opts;
+
+  unique_ptr<Image> input;
+  Kernel kernel;
+  // A separable tent, symmetric both ways, for the folding engines.
+  Kernel tent;
+  // The center row and column only, for the sparse engines.
+  Kernel cross;
+
+  // Opened before any worker threads exist so that they inherit them.
+  unique_ptr<PerfCounters> counters;
+
+  ConvBench(const BenchOptions& opts_) : opts(opts_), input(new Image()) {
+    if (opts.counters) {
+      counters.reset(new PerfCounters());
+    }
+
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        input->set(i, j, (i*NumCols + j) % 61);
+      }
+    }
+
+    for (int i = 0; i < KernelSize; i++) {
+      for (int j = 0; j < KernelSize; j++) {
+        kernel.set(i, j, (i + j) % 3 - 1);
+        tent.set(i, j, (KernelSize / 2 + 1 - abs(i - KernelSize / 2))*(KernelSize / 2 + 1 - abs(j - KernelSize / 2)));
+        cross.set(i, j, i == KernelSize / 2 || j == KernelSize / 2 ? i - j + 1 : 0);
+      }
+    }
+  }
+
+  BenchResult measure(const long workingSetBytes, const function<void()>& setup, const function<void()>& run) {
+    BenchResult r;
+    timeRuns(opts.warmup, opts.reps, PIXELS, (long) OUT_ROWS*OUT_COLS, setup, run, counters.get(), r);
+    r.bytesPerPixel = (double) workingSetBytes / PIXELS;
+    r.peakRss = peakRssBytes();
+    return r;
+  }
+
+  // Engines that read the frame from a Mem2D and write a Mem2D.
+  BenchResult benchMem2D(const long extraBytes, const function<void(OutImage&)>& run) {
+    unique_ptr<OutImage> output(new OutImage());
+    return measure(sizeof(Image) + sizeof(OutImage) + extraBytes, []() {}, [&]() { run(*output); });
+  }
+
+  // Engines that stream the frame through CircularFIFOs. Refilling the
+  // input FIFO and draining the output FIFO are not timed.
+  BenchResult benchFIFO(const long extraBytes, const function<void(InFIFO&, OutFIFO&)>& run) {
+    unique_ptr<InFIFO> in(new InFIFO());
+    unique_ptr<OutFIFO> out(new OutFIFO());
+
+    auto setup = [&]() {
+      while (!out->isEmpty()) {
+        out->pop();
+      }
+      for (int i = 0; i < NumRows; i++) {
+        for (int j = 0; j < NumCols; j++) {
+          in->write((*input)(i, j));
+        }
+      }
+    };
+
+    return measure(sizeof(Image) + sizeof(InFIFO) + sizeof(OutFIFO) + extraBytes, setup, [&]() { run(*in, *out); });
+  }
+
+  // File to file: stream a PGM with the given maxval through
+  // lineBufferConv into another PGM. Opening, parsing, reading, writing
+  // and flushing are all timed; the input file is written once up front
+  // and is usually in the page cache, so this measures the per row parse
+  // and format cost rather than the disk.
+  BenchResult benchPgmFile(const long extraBytes, const int maxVal) {
+    string inPath = benchTempPath("-in.pgm");
+    string outPath = benchTempPath("-out.pgm");
+
+    {
+      PnmWriter writer(inPath, NumCols, NumRows, 1, maxVal);
+      vector<ElemType> row(NumCols);
+      for (int i = 0; i < NumRows; i++) {
+        for (int j = 0; j < NumCols; j++) {
+          row[j] = (*input)(i, j);
+        }
+        writer.writeRow(row.data());
+      }
+      if (!writer.close()) {
+        return BenchResult();
+      }
+    }
+
+    BenchResult r = measure(extraBytes, []() {}, [&]() {
+        PnmReader reader(inPath);
+        PnmWriter writer(outPath, OUT_COLS, OUT_ROWS, 1, maxVal);
+        lineBufferConvPnm<ElemType, KernelSize, KernelSize, NumRows, NumCols>(reader, kernel, writer);
+      });
+
+    remove(inPath.c_str());
+    remove(outPath.c_str());
+    return r;
+  }
+
+  // lineBufferConv reading a raw frame file through a mapping instead of
+  // an input FIFO. Mapping the file is timed, draining the output FIFO is
+  // not.
+  BenchResult benchMappedFile(const long extraBytes) {
+    string path = benchTempPath(".raw");
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+      return BenchResult();
+    }
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        ElemType v = (*input)(i, j);
+        fwrite(&v, sizeof(v), 1, f);
+      }
+    }
+    fclose(f);
+
+    unique_ptr<OutFIFO> out(new OutFIFO());
+    auto setup = [&]() {
+      while (!out->isEmpty()) {
+        out->pop();
+      }
+    };
+
+    BenchResult r = measure(sizeof(OutFIFO) + extraBytes, setup, [&]() {
+        MappedFile file(path);
+        MappedFrame<ElemType, NumRows, NumCols> frame(file, 0);
+        lineBufferConvMapped<ElemType, KernelSize, KernelSize, NumRows, NumCols>(frame, kernel, *out);
+      });
+
+    remove(path.c_str());
+    return r;
+  }
+
+  // A RAW10 capture buffer convolved either by unpacking the whole frame
+  // to 16 bit samples first or by unpacking on line buffer write. Both
+  // timings include the unpacking.
+  BenchResult benchRaw10(const bool unpackFirst, const long lbBytes) {
+    const long stride = packedRowBytes(PACKED_RAW10, NumCols);
+    vector<uint8_t> packed(NumRows*stride);
+    vector<ElemType> row(NumCols);
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        row[j] = (*input)(i, j);
+      }
+      packRow(PACKED_RAW10, row.data(), NumCols, packed.data() + i*stride);
+    }
+
+    unique_ptr<OutFIFO> out(new OutFIFO());
+    auto setup = [&]() {
+      while (!out->isEmpty()) {
+        out->pop();
+      }
+    };
+
+    if (!unpackFirst) {
+      return measure(packed.size() + sizeof(OutFIFO) + lbBytes, setup, [&]() {
+          lineBufferConvPacked<ElemType, KernelSize, KernelSize, NumRows, NumCols>(packed.data(), PACKED_RAW10, stride, kernel, *out);
+        });
+    }
+
+    unique_ptr<InFIFO> in(new InFIFO());
+    return measure(packed.size() + sizeof(InFIFO) + sizeof(OutFIFO) + lbBytes, setup, [&]() {
+        for (int i = 0; i < NumRows; i++) {
+          unpackRow(PACKED_RAW10, packed.data() + i*stride, NumCols, row.data());
+          for (int j = 0; j < NumCols; j++) {
+            in->write(row[j]);
+          }
+        }
+        lineBufferConv<ElemType, KernelSize, KernelSize, NumRows, NumCols>(*in, kernel, *out);
+      });
+  }
+
+  // Four kernels over one frame, as a filter bank in one pass or as four
+  // lineBufferConv passes. Both read the frame straight from the Mem2D.
+  BenchResult benchBank(const bool onePass, const long lbBytes) {
+    const int NUM_KERNELS = 4;
+    FilterBank<ElemType, NUM_KERNELS, KernelSize, KernelSize> bank;
+    for (int k = 0; k < NUM_KERNELS; k++) {
+      Kernel rotated;
+      for (int i = 0; i < KernelSize; i++) {
+        for (int j = 0; j < KernelSize; j++) {
+          rotated.set(i, j, k % 2 == 0 ? kernel(i, j) : kernel(j, i));
+        }
+      }
+      bank.set(k, rotated);
+    }
+
+    if (onePass) {
+      return measure(sizeof(Image) + lbBytes, []() {}, [&]() {
+          Mem2DSource<ElemType, NumRows, NumCols> source(*input);
+          ChecksumSink sink;
+          lineBufferConvBank<ElemType, NUM_KERNELS, KernelSize, KernelSize, NumRows, NumCols>(source, bank, sink);
+        });
+    }
+
+    return measure(sizeof(Image) + lbBytes, []() {}, [&]() {
+        for (int k = 0; k < NUM_KERNELS; k++) {
+          Mem2DSource<ElemType, NumRows, NumCols> source(*input);
+          ChecksumSink sink;
+          lineBufferConvStream<ElemType, KernelSize, KernelSize, NumRows, NumCols>(source, bank[k], sink);
+        }
+      });
+  }
+
+  BenchResult run(const string& engine) {
+    const long LB_BYTES = ((KernelSize - 1)*NumCols + (KernelSize / 2) + KernelSize)*sizeof(ElemType);
+
+    if (engine == "bulk") {
+      return benchMem2D(0, [&](OutImage& out) {
+          bulkConv<ElemType, KernelSize, KernelSize, NumRows, NumCols>(*input, kernel, out);
+        });
+    }
+
+    if (engine == "linebuffer") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          lineBufferConv<ElemType, KernelSize, KernelSize, NumRows, NumCols>(in, kernel, out);
+        });
+    }
+
+    if (engine == "stencil") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          lineBufferStencil<int, KernelSize, KernelSize, NumRows, NumCols>(in, out, MacStencil<ElemType, KernelSize>(kernel));
+        });
+    }
+
+    if (engine == "symmetric-plain") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          lineBufferConvStream<ElemType, KernelSize, KernelSize, NumRows, NumCols>(in, tent, out);
+        });
+    }
+
+    if (engine == "symmetric-folded") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          lineBufferConvSymmetric<ElemType, KernelSize, KernelSize, NumRows, NumCols>(in, tent, out);
+        });
+    }
+
+    if (engine == "fft") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          lineBufferConvFFT<ElemType, KernelSize, KernelSize, NumRows, NumCols>(in, kernel, out);
+        });
+    }
+
+    if (engine == "cross-dense") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          lineBufferConvStream<ElemType, KernelSize, KernelSize, NumRows, NumCols>(in, cross, out);
+        });
+    }
+
+    if (engine == "cross-sparse") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          lineBufferConv<ElemType, KernelSize, KernelSize, NumRows, NumCols>(in, cross, out);
+        });
+    }
+
+    typedef typename FixedKernel<KernelSize>::Kernel Fixed;
+
+    if (engine == "fixed-runtime") {
+      const Mem2D<ElemType, Fixed::ROWS, Fixed::COLS> fixed = Fixed::template toMem2D<ElemType>();
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          lineBufferConvStream<ElemType, Fixed::ROWS, Fixed::COLS, NumRows, NumCols>(in, fixed, out);
+        });
+    }
+
+    if (engine == "fixed-static") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          lineBufferConvStatic<Fixed, NumRows, NumCols>(in, out);
+        });
+    }
+
+    if (engine == "linebuffer3x3") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO& out) {
+          RegisterWindowEngine<ElemType, KernelSize, NumRows, NumCols>::run(in, kernel, out);
+        });
+    }
+
+    // Only the line buffer and one row each of input and output are
+    // resident, plus the stdio buffers.
+    const long PGM_BYTES = LB_BYTES + (NumCols + OUT_COLS)*sizeof(ElemType) + 2*PNM_IO_BUFFER_BYTES;
+
+    if (engine == "pgm8-file") {
+      return benchPgmFile(PGM_BYTES, 255);
+    }
+
+    if (engine == "pgm16-file") {
+      return benchPgmFile(PGM_BYTES, 65535);
+    }
+
+    if (engine == "raw10-packed") {
+      return benchRaw10(false, LB_BYTES);
+    }
+
+    if (engine == "raw10-unpacked") {
+      return benchRaw10(true, LB_BYTES);
+    }
+
+    if (engine == "bank4") {
+      return benchBank(true, LB_BYTES);
+    }
+
+    if (engine == "bank4-passes") {
+      return benchBank(false, LB_BYTES);
+    }
+
+    if (engine == "demosaic") {
+      return benchFIFO(LB_BYTES, [&](InFIFO& in, OutFIFO&) {
+          ChecksumSink sink;
+          DemosaicEngine<KernelSize>::template run<NumRows, NumCols>(in, sink);
+        });
+    }
+
+    if (engine == "mmap-file") {
+      return benchMappedFile(LB_BYTES + 2*MAPPED_ADVICE_WINDOW_BYTES);
+    }
+
+    ThreadPool pool(opts.threads);
+
+    if (engine == "parallel") {
+      return benchMem2D(opts.threads*LB_BYTES, [&](OutImage& out) {
+          lineBufferConvParallel(*input, kernel, out, pool);
+        });
+    }
+
+    if (engine == "tiled") {
+      return benchMem2D(opts.threads*LB_BYTES, [&](OutImage& out) {
+          lineBufferConvTiled(*input, kernel, out, pool);
+        });
+    }
+
+    return BenchResult();
+  }
+};
+
+// One row of the --footprint report: the line buffer convolution's
+// working set, whether it fits this machine's L2, and the storage of the
+// whole streamed pipeline including its frame FIFOs.
+template<typename ElemType, int KernelSize, int NumRows, int NumCols>
+void printFootprint(ostream& out, const string& sizeName) {
+  const int OUT_ROWS = NumRows - 2*(KernelSize / 2);
+  const int OUT_COLS = NumCols - 2*(KernelSize / 2);
+
+  constexpr Footprint conv = lineBufferConvFootprint<ElemType, KernelSize, KernelSize, NumRows, NumCols>();
+  constexpr Footprint stream = conv + pipelineFootprint<CircularFIFO<ElemType, NumRows*NumCols>,
+                                                        CircularFIFO<ElemType, OUT_ROWS*OUT_COLS> >();
+
+  out << ElemTypeName<ElemType>::name() << "\t" << sizeName << "\t" << KernelSize << "x" << KernelSize
+      << "\t" << conv.bytes << "\t" << conv.lines << "\t" << conv.registers << "\t" << conv.brams
+      << "\t" << (cacheBudget(hostCacheInfo().l2Bytes).admits(conv) ? "yes" : "no")
+      << "\t" << stream.bytes << "\t" << stream.brams << endl;
+}
+
+template<typename ElemType, int KernelSize, int NumRows, int NumCols>
+void benchConfig(const BenchOptions& opts, const string& sizeName, vector<BenchResult>& results) {
+  if (!opts.wantsKernel(KernelSize)) {
+    return;
+  }
+
+  if (opts.footprint) {
+    printFootprint<ElemType, KernelSize, NumRows, NumCols>(cout, sizeName);
+    return;
+  }
+
+  // Each engine gets its own child process so peak RSS is per engine.
+  vector<string> engines = {"bulk", "linebuffer", "stencil", "fixed-runtime", "fixed-static", "symmetric-plain", "symmetric-folded",
+                            "cross-dense", "cross-sparse", "fft", "linebuffer3x3", "parallel", "tiled",
+                            "pgm8-file", "pgm16-file", "mmap-file",
+                            "raw10-packed", "raw10-unpacked", "bank4", "bank4-passes", "demosaic"};
+  for (auto& engine : engines) {
+    if (!opts.wantsEngine(engine)) {
+      continue;
+    }
+
+    if (engine == "linebuffer3x3" &&
+        !RegisterWindowEngine<ElemType, KernelSize, NumRows, NumCols>::available) {
+      continue;
+    }
+
+    if ((engine == "fixed-runtime" || engine == "fixed-static") && !FixedKernel<KernelSize>::available) {
+      continue;
+    }
+
+    if (engine == "demosaic" && !DemosaicEngine<KernelSize>::available) {
+      continue;
+    }
+
+    BenchResult r = runIsolated(opts.fork, [&]() {
+        ConvBench<ElemType, KernelSize, NumRows, NumCols> bench(opts);
+        return bench.run(engine);
+      });
+
+    if (r.nsPerPixel.empty()) {
+      continue;
+    }
+
+    r.engine = engine;
+    r.elemType = ElemTypeName<ElemType>::name();
+    r.size = sizeName;
+    r.rows = NumRows;
+    r.cols = NumCols;
+    r.kernel = KernelSize;
+    r.warmup = opts.warmup;
+    results.push_back(r);
+
+    cerr << engine << " " << r.elemType << " " << sizeName << " " << KernelSize << "x" << KernelSize
+         << ": " << r.stats().median << " ns/pixel" << endl;
+  }
+}
+
+template<typename ElemType, int NumRows, int NumCols>
+void benchKernels(const BenchOptions& opts, const string& sizeName, vector<BenchResult>& results) {
+  benchConfig<ElemType, 3, NumRows, NumCols>(opts, sizeName, results);
+  benchConfig<ElemType, 5, NumRows, NumCols>(opts, sizeName, results);
+  benchConfig<ElemType, 7, NumRows, NumCols>(opts, sizeName, results);
+  benchConfig<ElemType, 9, NumRows, NumCols>(opts, sizeName, results);
+  benchConfig<ElemType, 11, NumRows, NumCols>(opts, sizeName, results);
+  benchConfig<ElemType, 13, NumRows, NumCols>(opts, sizeName, results);
+  benchConfig<ElemType, 15, NumRows, NumCols>(opts, sizeName, results);
+}
+
+template<int NumRows, int NumCols>
+void benchSize(const BenchOptions& opts, const string& sizeName, vector<BenchResult>& results) {
+  if (!opts.wantsSize(sizeName)) {
+    return;
+  }
+
+  if (opts.wantsType("int16")) {
+    benchKernels<int16_t, NumRows, NumCols>(opts, sizeName, results);
+  }
+  if (opts.wantsType("int32")) {
+    benchKernels<int32_t, NumRows, NumCols>(opts, sizeName, results);
+  }
+}
+
+// Sweeps every convolution engine over frame sizes, kernel sizes and
+// element types. Progress goes to stderr, results to stdout.
+//
+//   swlb-bench [--sizes=vga,720p,1080p,4k,8k] [--kernels=3,5,...,15]
+//              [--types=int16,int32] [--engines=bulk,linebuffer,...]
+//              [--reps=5] [--warmup=1] [--threads=N] [--format=json|csv]
+//              [--no-fork] [--no-counters] [--footprint]
+//              [--baseline-file=swlb-baseline.json]
+//              [--save-baseline=NAME] [--compare=NAME]
+//
+// --footprint prints the storage each configuration needs instead of
+// timing anything.
+// --save-baseline stores this run under NAME in the baseline file.
+// --compare checks this run against baseline NAME and exits with status
+// 2 if any configuration got significantly slower.
+int main(int argc, char** argv) {
+  BenchOptions opts;
+  if (!opts.parse(argc, argv)) {
+    return 1;
+  }
+
+  if (opts.counters && !opts.footprint && !PerfCounters().anyAvailable()) {
+    cerr << "Hardware counters unavailable (perf_event_open denied?), reporting timings only" << endl;
+  }
+
+  if (opts.footprint) {
+    cout << "type\tsize\tkernel\tbytes\tlines\tregisters\tbram18\tfits_l2\tstream_bytes\tstream_bram18" << endl;
+  }
+
+  vector<BenchResult> results;
+
+  benchSize<480, 640>(opts, "vga", results);
+  benchSize<720, 1280>(opts, "720p", results);
+  benchSize<1080, 1920>(opts, "1080p", results);
+  benchSize<2160, 3840>(opts, "4k", results);
+  benchSize<4320, 7680>(opts, "8k", results);
+
+  if (opts.footprint) {
+    return 0;
+  }
+
+  if (opts.format == "csv") {
+    printCsv(cout, results);
+  } else {
+    printJson(cout, results);
+  }
+
+  if (!opts.saveBaseline.empty()) {
+    if (!saveBaseline(opts.baselineFile, opts.saveBaseline, results)) {
+      cerr << "Could not write baseline file " << opts.baselineFile << endl;
+      return 1;
+    }
+    cerr << "Saved baseline " << opts.saveBaseline << " to " << opts.baselineFile << endl;
+  }
+
+  if (!opts.compareBaseline.empty()) {
+    map<string, Baseline> baselines;
+    if (!loadBaselines(opts.baselineFile, baselines) ||
+        baselines.find(opts.compareBaseline) == baselines.end()) {
+      cerr << "No baseline " << opts.compareBaseline << " in " << opts.baselineFile << endl;
+      return 1;
+    }
+
+    int regressions = reportComparison(cerr, baselines[opts.compareBaseline], results);
+    if (regressions > 0) {
+      cerr << regressions << " significant regression(s) against " << opts.compareBaseline << endl;
+      return 2;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,197 @@
+#include "y4m.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace swlb;
+
+// A sharpening cross: the centre tap outweighs the arms by one so the
+// kernel sums to 1 and flat areas keep their level. Edges overshoot in
+// both directions; Y4mWriter clamps the results to the stream's range.
+template<int KernelSize>
+Mem2D<int, KernelSize, KernelSize> sharpenKernel() {
+  const int m = KernelSize / 2;
+  Mem2D<int, KernelSize, KernelSize> kernel;
+  for (int d = 1; d <= m; d++) {
+    kernel.set(m - d, m, -1);
+    kernel.set(m + d, m, -1);
+    kernel.set(m, m - d, -1);
+    kernel.set(m, m + d, -1);
+  }
+  kernel.set(m, m, 1 + 4*m);
+  return kernel;
+}
+
+// The output is only opened once the geometry is known to be supported,
+// so an unsupported input does not leave a header-only file behind.
+template<int KernelSize, int NumRows, int NumCols, ChromaFormat Chroma, typename Reader>
+bool tryPipeline(Reader& reader, const string& outPath, long& frames) {
+  typedef VideoConvPipeline<int, KernelSize, KernelSize, NumRows, NumCols, Chroma> Pipeline;
+  if (!Pipeline::matches(reader.format())) {
+    return false;
+  }
+
+  Y4mWriter writer(outPath, reader.format());
+  Pipeline pipeline(sharpenKernel<KernelSize>());
+  frames = pipeline.run(reader, writer);
+  return true;
+}
+
+template<int KernelSize, int NumRows, int NumCols, typename Reader>
+bool tryChroma(Reader& reader, const string& outPath, long& frames) {
+  return tryPipeline<KernelSize, NumRows, NumCols, CHROMA_420>(reader, outPath, frames) ||
+    tryPipeline<KernelSize, NumRows, NumCols, CHROMA_422>(reader, outPath, frames) ||
+    tryPipeline<KernelSize, NumRows, NumCols, CHROMA_444>(reader, outPath, frames) ||
+    tryPipeline<KernelSize, NumRows, NumCols, CHROMA_MONO>(reader, outPath, frames);
+}
+
+template<int KernelSize, typename Reader>
+bool trySizes(Reader& reader, const string& outPath, long& frames) {
+  return tryChroma<KernelSize, 480, 640>(reader, outPath, frames) ||
+    tryChroma<KernelSize, 720, 1280>(reader, outPath, frames) ||
+    tryChroma<KernelSize, 1080, 1920>(reader, outPath, frames) ||
+    tryChroma<KernelSize, 2160, 3840>(reader, outPath, frames);
+}
+
+template<typename Reader>
+int filter(Reader& reader, const string& outPath, const int kernelSize) {
+  if (!reader.isValid()) {
+    cerr << "Could not read the input stream header" << endl;
+    return 1;
+  }
+
+  const VideoFormat& fmt = reader.format();
+
+  auto start = chrono::steady_clock::now();
+
+  long frames = -1;
+  bool supported = kernelSize == 3 ? trySizes<3>(reader, outPath, frames) : trySizes<5>(reader, outPath, frames);
+  if (!supported) {
+    cerr << "Unsupported geometry " << fmt.width << "x" << fmt.height << " C" << fmt.colorspaceTag()
+         << " (640x480, 1280x720, 1920x1080 and 3840x2160 are built in)" << endl;
+    return 1;
+  }
+
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  if (frames < 0) {
+    cerr << "Stream error" << endl;
+    return 1;
+  }
+
+  double fps = frames / seconds;
+  double samples = (double) frames*fmt.frameBytes() / fmt.bytesPerSample();
+  double streamFps = (double) fmt.fpsNum / fmt.fpsDen;
+  cerr << frames << " frames " << fmt.width << "x" << fmt.height << " C" << fmt.colorspaceTag()
+       << " " << kernelSize << "x" << kernelSize << " in " << seconds << " s: "
+       << fps << " fps, " << 1e9*seconds / samples << " ns/sample, "
+       << fps / streamFps << "x realtime at " << streamFps << " fps" << endl;
+  return 0;
+}
+
+// Writes numFrames of a moving 1080p60 4:2:0 test pattern to fd.
+void generateSynthetic(const int fd, const int numFrames) {
+  VideoFormat fmt(1920, 1080, CHROMA_420);
+  fmt.fpsNum = 60;
+  Y4mWriter writer("/dev/fd/" + to_string(fd), fmt);
+
+  vector<int> row(fmt.width);
+  for (int f = 0; f < numFrames; f++) {
+    writer.beginFrame();
+    for (int p = 0; p < fmt.planes(); p++) {
+      for (int i = 0; i < fmt.rows(p); i++) {
+        for (int j = 0; j < fmt.cols(p); j++) {
+          row[j] = (i + j + 3*f + 64*p) & 0xff;
+        }
+        writer.writeRow(p, row.data());
+      }
+    }
+  }
+  writer.flush();
+}
+
+bool parseRawFormat(const string& spec, VideoFormat& fmt) {
+  char chroma[16] = "420";
+  if (sscanf(spec.c_str(), "%dx%d:%15s", &fmt.width, &fmt.height, chroma) < 2) {
+    return false;
+  }
+  return fmt.parseColorspaceTag(chroma);
+}
+
+// Sharpens a video stream, for use between a decoder and an encoder:
+//
+//   ffmpeg -i in.mp4 -f yuv4mpegpipe - | swlb-video - - | ffmpeg -i - out.mp4
+//
+//   swlb-video [--kernel=3|5] [--raw=WxH[:420|422|444|mono]] [IN|-] [OUT|-]
+//   swlb-video [--kernel=3|5] --synthetic=FRAMES
+//
+// --raw reads headerless planar YUV instead of Y4M; the output is always
+// Y4M. --synthetic measures throughput on generated 1080p60 frames fed
+// through a pipe from a child process, discarding the output. Throughput
+// is reported on stderr.
+int main(int argc, char** argv) {
+  int kernelSize = 3;
+  int synthetic = 0;
+  string rawSpec;
+  vector<string> paths;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg.compare(0, 9, "--kernel=") == 0) {
+      kernelSize = atoi(arg.c_str() + 9);
+    } else if (arg.compare(0, 6, "--raw=") == 0) {
+      rawSpec = arg.substr(6);
+    } else if (arg.compare(0, 12, "--synthetic=") == 0) {
+      synthetic = atoi(arg.c_str() + 12);
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  if (kernelSize != 3 && kernelSize != 5) {
+    cerr << "--kernel must be 3 or 5" << endl;
+    return 1;
+  }
+
+  if (synthetic > 0) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      return 1;
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+      close(fds[0]);
+      generateSynthetic(fds[1], synthetic);
+      _exit(0);
+    }
+    close(fds[1]);
+
+    Y4mReader reader("/dev/fd/" + to_string(fds[0]));
+    int status = filter(reader, "/dev/null", kernelSize);
+    close(fds[0]);
+    waitpid(child, nullptr, 0);
+    return status;
+  }
+
+  string inPath = paths.size() > 0 ? paths[0] : "-";
+  string outPath = paths.size() > 1 ? paths[1] : "-";
+
+  if (!rawSpec.empty()) {
+    VideoFormat fmt;
+    if (!parseRawFormat(rawSpec, fmt)) {
+      cerr << "Bad --raw format " << rawSpec << endl;
+      return 1;
+    }
+    RawYuvReader reader(inPath, fmt);
+    return filter(reader, outPath, kernelSize);
+  }
+
+  Y4mReader reader(inPath);
+  return filter(reader, outPath, kernelSize);
+}
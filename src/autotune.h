@@ -0,0 +1,395 @@
+#pragma once
+
+#include "fft_conv.h"
+#include "lb.h"
+#include "parallel.h"
+#include "symmetric.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  // Streams a Mem2D frame in row major order, for running the streaming
+  // engines on a frame in memory.
+  template<typename ElemType, int NumRows, int NumCols>
+  class Mem2DPixelSource {
+
+    const Mem2D<ElemType, NumRows, NumCols>& image;
+    int row;
+    int col;
+
+  public:
+
+    Mem2DPixelSource(const Mem2D<ElemType, NumRows, NumCols>& image_) : image(image_), row(0), col(0) {}
+
+    ElemType read() const {
+      return image(row, col);
+    }
+
+    void pop() {
+      col++;
+      if (col == NumCols) {
+        col = 0;
+        row++;
+      }
+    }
+
+    bool isEmpty() const {
+      return row == NumRows;
+    }
+  };
+
+  template<typename ElemType, int NumRows, int NumCols>
+  class Mem2DPixelSink {
+
+    Mem2D<ElemType, NumRows, NumCols>& image;
+    int row;
+    int col;
+
+  public:
+
+    Mem2DPixelSink(Mem2D<ElemType, NumRows, NumCols>& image_) : image(image_), row(0), col(0) {}
+
+    void write(const ElemType value) {
+      image.set(row, col, value);
+      col++;
+      if (col == NumCols) {
+        col = 0;
+        row++;
+      }
+    }
+  };
+
+  // The CPU model from /proc/cpuinfo, which plans are keyed by.
+  static inline
+  string detectCpuModel() {
+    ifstream in("/proc/cpuinfo");
+    string line;
+    while (getline(in, line)) {
+      if (line.compare(0, 10, "model name") == 0) {
+        size_t colon = line.find(':');
+        if (colon != string::npos) {
+          size_t start = line.find_first_not_of(" \t", colon + 1);
+          return start == string::npos ? "unknown" : line.substr(start);
+        }
+      }
+    }
+    return "unknown";
+  }
+
+  inline
+  const string& hostCpuModel() {
+    static const string model = detectCpuModel();
+    return model;
+  }
+
+  template<typename ElemType>
+  string convTypeName() {
+    string kind = is_floating_point<ElemType>::value ? "float" : is_signed<ElemType>::value ? "int" : "uint";
+    return kind + to_string(8*sizeof(ElemType));
+  }
+
+  // An engine and its parameter: the tile width for "tiled", the number
+  // of strips for "parallel" (0 for one per worker), unused otherwise.
+  class ConvPlan {
+  public:
+    string engine;
+    int param;
+    double nsPerPixel;
+
+    ConvPlan() : param(0), nsPerPixel(0) {}
+    ConvPlan(const string& engine_, const int param_) : engine(engine_), param(param_), nsPerPixel(0) {}
+  };
+
+  // lineBufferConv3x3 only exists for 3x3 kernels, and streams between
+  // whole frame FIFOs.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  class RegisterWindowConv {
+  public:
+    static const bool available = false;
+
+    static void run(const Mem2D<ElemType, NumImageRows, NumImageCols>&,
+                    const Mem2D<ElemType, NumKernelRows, NumKernelCols>&,
+                    Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>&) {}
+  };
+
+  template<typename ElemType, int NumImageRows, int NumImageCols>
+  class RegisterWindowConv<ElemType, 3, 3, NumImageRows, NumImageCols> {
+  public:
+    static const bool available = true;
+
+    static void run(const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                    const Mem2D<ElemType, 3, 3>& kernel,
+                    Mem2D<ElemType, NumImageRows - 2, NumImageCols - 2>& output) {
+      unique_ptr<CircularFIFO<ElemType, NumImageRows*NumImageCols> > in(new CircularFIFO<ElemType, NumImageRows*NumImageCols>());
+      unique_ptr<CircularFIFO<ElemType, (NumImageRows - 2)*(NumImageCols - 2)> >
+        out(new CircularFIFO<ElemType, (NumImageRows - 2)*(NumImageCols - 2)>());
+
+      for (int i = 0; i < NumImageRows; i++) {
+        for (int j = 0; j < NumImageCols; j++) {
+          in->write(input(i, j));
+        }
+      }
+
+      lineBufferConv3x3<ElemType, NumImageRows, NumImageCols>(*in, kernel, *out);
+
+      for (int i = 0; i < NumImageRows - 2; i++) {
+        for (int j = 0; j < NumImageCols - 2; j++) {
+          output.set(i, j, out->read());
+          out->pop();
+        }
+      }
+    }
+  };
+
+  // Runs the engine a plan names. Returns false, leaving output alone, if
+  // there is no such engine for this configuration.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  bool runConvPlan(const ConvPlan& plan,
+                   const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                   const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                   Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                   ThreadPool& pool) {
+
+    const int NumOutRows = NumImageRows - 2*(NumKernelRows / 2);
+    const int NumOutCols = NumImageCols - 2*(NumKernelCols / 2);
+
+    Mem2DPixelSource<ElemType, NumImageRows, NumImageCols> source(input);
+    Mem2DPixelSink<ElemType, NumOutRows, NumOutCols> sink(output);
+
+    if (plan.engine == "bulk") {
+      bulkConv<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(input, kernel, output);
+    } else if (plan.engine == "linebuffer") {
+      lineBufferConvStream<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(source, kernel, sink);
+    } else if (plan.engine == "sparse") {
+      const SparseKernel<ElemType, NumKernelRows, NumKernelCols> taps(kernel);
+      lineBufferConvSparse<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(source, taps, sink);
+    } else if (plan.engine == "symmetric") {
+      lineBufferConvSymmetric<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(source, kernel, sink);
+    } else if (plan.engine == "fft") {
+      lineBufferConvFFT<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(source, kernel, sink);
+    } else if (plan.engine == "linebuffer3x3" &&
+               RegisterWindowConv<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>::available) {
+      RegisterWindowConv<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>::run(input, kernel, output);
+    } else if (plan.engine == "tiled" && plan.param > 0) {
+      PlannedTileDispatch<MIN_PLANNED_TILE_COLS>::run(plan.param, input, kernel, output, pool, DEFAULT_TILE_ROWS);
+    } else if (plan.engine == "parallel" && plan.param >= 0) {
+      lineBufferConvParallel(input, kernel, output, pool, plan.param);
+    } else {
+      return false;
+    }
+
+    return true;
+  }
+
+  // Every engine, with the parameters worth trying, that can run this
+  // kernel on a NumImageRows x NumImageCols frame.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  vector<ConvPlan> convCandidates(const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) {
+    const int NumOutCols = NumImageCols - 2*(NumKernelCols / 2);
+
+    vector<ConvPlan> candidates;
+    candidates.push_back(ConvPlan("bulk", 0));
+    candidates.push_back(ConvPlan("linebuffer", 0));
+
+    if (SparseKernel<ElemType, NumKernelRows, NumKernelCols>(kernel).size() < kernel.size()) {
+      candidates.push_back(ConvPlan("sparse", 0));
+    }
+    if (kernelSymmetry(kernel) != SYMMETRY_NONE) {
+      candidates.push_back(ConvPlan("symmetric", 0));
+    }
+    if (RegisterWindowConv<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>::available) {
+      candidates.push_back(ConvPlan("linebuffer3x3", 0));
+    }
+    candidates.push_back(ConvPlan("fft", 0));
+
+    for (int tileCols = 64; tileCols < NumOutCols; tileCols *= 4) {
+      candidates.push_back(ConvPlan("tiled", tileCols));
+    }
+    candidates.push_back(ConvPlan("parallel", 0));
+
+    return candidates;
+  }
+
+  // Picks the fastest convolution engine for each configuration by timing
+  // every candidate the first time it is asked, and remembers the winners
+  // in a plan file so later runs, including later processes, go straight
+  // to the right engine. A configuration is the CPU model, element type,
+  // image and kernel size, and the kernel's symmetry and non-zero tap
+  // count, which decide whether the folding and sparse engines apply.
+  //
+  // The plan file holds one plan per line, tab separated:
+  //   cpu model, configuration, engine, parameter, ns per pixel
+  // Plans for other CPUs are kept, so one file can be shared between
+  // machines.
+  class ConvPlanner {
+
+    string path;
+    string cpu;
+    int reps;
+
+    map<pair<string, string>, ConvPlan> plans;
+    int numTunings;
+
+    void load() {
+      ifstream in(path);
+      string line;
+      while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+          continue;
+        }
+
+        vector<string> fields;
+        istringstream split(line);
+        string field;
+        while (getline(split, field, '\t')) {
+          fields.push_back(field);
+        }
+        if (fields.size() != 5) {
+          continue;
+        }
+
+        ConvPlan plan(fields[2], atoi(fields[3].c_str()));
+        plan.nsPerPixel = atof(fields[4].c_str());
+        plans[make_pair(fields[0], fields[1])] = plan;
+      }
+    }
+
+    template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+    ConvPlan tune(const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                  const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                  Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                  ThreadPool& pool) {
+      numTunings++;
+
+      ConvPlan best;
+      for (auto& candidate : convCandidates<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(kernel)) {
+        // Called through a std::function so the work cannot be moved out
+        // of the timed region.
+        const function<void()> run = [&]() {
+          runConvPlan(candidate, input, kernel, output, pool);
+        };
+
+        double bestNs = 0;
+        for (int rep = 0; rep < reps; rep++) {
+          auto start = chrono::steady_clock::now();
+          run();
+          auto end = chrono::steady_clock::now();
+
+          double ns = chrono::duration<double, nano>(end - start).count() / ((double) NumImageRows*NumImageCols);
+          if (rep == 0 || ns < bestNs) {
+            bestNs = ns;
+          }
+        }
+
+        if (best.engine.empty() || bestNs < best.nsPerPixel) {
+          best = candidate;
+          best.nsPerPixel = bestNs;
+        }
+      }
+
+      return best;
+    }
+
+  public:
+
+    // Loads any plans already in path. reps is how many times each
+    // candidate is timed, keeping the best.
+    ConvPlanner(const string& path_, const string& cpu_ = hostCpuModel(), const int reps_ = 3) :
+      path(path_), cpu(cpu_), reps(reps_), numTunings(0) {
+      load();
+    }
+
+    template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+    static string configKey(const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) {
+      ostringstream key;
+      key << convTypeName<ElemType>() << " " << NumImageRows << "x" << NumImageCols
+          << " " << NumKernelRows << "x" << NumKernelCols
+          << " symmetry=" << kernelSymmetry(kernel)
+          << " taps=" << SparseKernel<ElemType, NumKernelRows, NumKernelCols>(kernel).size();
+      return key.str();
+    }
+
+    // How many configurations this planner has had to time.
+    int tunings() const {
+      return numTunings;
+    }
+
+    bool lookup(const string& config, ConvPlan& plan) const {
+      auto found = plans.find(make_pair(cpu, config));
+      if (found == plans.end()) {
+        return false;
+      }
+      plan = found->second;
+      return true;
+    }
+
+    void record(const string& config, const ConvPlan& plan) {
+      plans[make_pair(cpu, config)] = plan;
+    }
+
+    bool save() const {
+      ofstream out(path);
+      if (!out) {
+        return false;
+      }
+
+      out << "# cpu\tconfiguration\tengine\tparameter\tns_per_pixel" << endl;
+      for (auto& p : plans) {
+        out << p.first.first << "\t" << p.first.second << "\t"
+            << p.second.engine << "\t" << p.second.param << "\t" << p.second.nsPerPixel << endl;
+      }
+
+      return (bool) out;
+    }
+
+    // The plan for this configuration, tuned on input and saved if there
+    // is none yet. output is scratch space while tuning.
+    template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+    ConvPlan plan(const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                  const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                  Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                  ThreadPool& pool) {
+      const string config = configKey<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(kernel);
+
+      ConvPlan p;
+      if (lookup(config, p)) {
+        return p;
+      }
+
+      p = tune(input, kernel, output, pool);
+      record(config, p);
+      save();
+      return p;
+    }
+
+    // Convolves with the planned engine. A plan naming an engine this
+    // build does not have is tuned again.
+    template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+    ConvPlan run(const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                 const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                 Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                 ThreadPool& pool) {
+      ConvPlan p = plan(input, kernel, output, pool);
+      if (!runConvPlan(p, input, kernel, output, pool)) {
+        p = tune(input, kernel, output, pool);
+        record(configKey<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(kernel), p);
+        save();
+        runConvPlan(p, input, kernel, output, pool);
+      }
+      return p;
+    }
+  };
+
+}
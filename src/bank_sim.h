@@ -0,0 +1,232 @@
+#pragma once
+
+#include "lb.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  // What one RAM bank can do in a clock: one access of either kind, one
+  // read plus one write, or any two accesses.
+  enum RamPorts {
+    SINGLE_PORT,
+    SIMPLE_DUAL_PORT,
+    TRUE_DUAL_PORT
+  };
+
+  // How windows are read out of the buffer. FULL_WINDOW reads every tap
+  // of each valid window, as ImageBuffer::read does. REGISTER_WINDOW keeps
+  // the window in registers and reads only the column entering it, once
+  // per pixel, as ImageBuffer3x3 does.
+  enum WindowReads {
+    FULL_WINDOW,
+    REGISTER_WINDOW
+  };
+
+  // A line buffer of lbSize entries split into RAM banks of ramWidth
+  // entries each, entry i living at ramAddress(i).
+  class BankedLineBuffer {
+  public:
+    int windowRows;
+    int windowCols;
+    int imageRows;
+    int imageCols;
+
+    int lbSize;
+    int ramWidth;
+    RamPorts ports;
+    WindowReads reads;
+
+    int numRAMs() const {
+      return (lbSize + ramWidth - 1) / ramWidth;
+    }
+
+    RAMAddr ramAddress(const int entry) const {
+      RAMAddr addr;
+      addr.ramNumber = entry / ramWidth;
+      addr.indexInRAM = entry % ramWidth;
+      addr.numRAMs = numRAMs();
+      addr.ramWidth = ramWidth;
+      return addr;
+    }
+  };
+
+  // ImageBuffer's storage, one bank per image row.
+  template<int WindowRows, int WindowCols, int NumImageRows, int NumImageCols>
+  BankedLineBuffer imageBufferBanks(const RamPorts ports) {
+    BankedLineBuffer lb;
+    lb.windowRows = WindowRows;
+    lb.windowCols = WindowCols;
+    lb.imageRows = NumImageRows;
+    lb.imageCols = NumImageCols;
+    lb.lbSize = (WindowRows - 1)*NumImageCols + (WindowCols / 2) + WindowCols;
+    lb.ramWidth = NumImageCols;
+    lb.ports = ports;
+    lb.reads = FULL_WINDOW;
+    return lb;
+  }
+
+  // ImageBuffer3x3's storage: line0, line1 and the short line2.
+  template<int NumImageRows, int NumImageCols>
+  BankedLineBuffer imageBuffer3x3Banks(const RamPorts ports) {
+    BankedLineBuffer lb = imageBufferBanks<3, 3, NumImageRows, NumImageCols>(ports);
+    lb.reads = REGISTER_WINDOW;
+    return lb;
+  }
+
+  class BankStats {
+  public:
+    long reads;
+    long writes;
+    int peakReads;
+    int peakWrites;
+    // Pixels for which this bank needed more than one clock.
+    long conflicts;
+
+    BankStats() : reads(0), writes(0), peakReads(0), peakWrites(0), conflicts(0) {}
+  };
+
+  class BankSimReport {
+  public:
+    long pixels;
+    long outputs;
+    long cycles;
+    // Pixels that stalled on a port conflict, and the clocks lost to them.
+    long conflictPixels;
+    long stallCycles;
+    // Window taps that were the pixel being written and were forwarded
+    // from the input instead of read back.
+    long forwardedReads;
+    vector<BankStats> banks;
+
+    BankSimReport() : pixels(0), outputs(0), cycles(0), conflictPixels(0), stallCycles(0), forwardedReads(0) {}
+
+    // Clocks per input pixel; 1 when the buffer never stalls.
+    double initiationInterval() const {
+      return pixels == 0 ? 0 : (double) cycles / pixels;
+    }
+
+    double pixelsPerClock() const {
+      return cycles == 0 ? 0 : (double) pixels / cycles;
+    }
+
+    double outputsPerClock() const {
+      return cycles == 0 ? 0 : (double) outputs / cycles;
+    }
+  };
+
+  // Clocks a bank needs for the given accesses.
+  static inline
+  int bankCycles(const RamPorts ports, const int reads, const int writes) {
+    if (ports == SINGLE_PORT) {
+      return reads + writes;
+    } else if (ports == SIMPLE_DUAL_PORT) {
+      return max(reads, writes);
+    }
+    return (reads + writes + 1) / 2;
+  }
+
+  // Streams one frame through a banked line buffer, one input pixel per
+  // step, and counts the accesses each step makes to each bank. The
+  // write address is walked with increment(), wrapping at lbSize. A step
+  // takes as many clocks as its busiest bank needs, and at least one, so
+  // the initiation interval is 1 exactly when no bank is ever asked for
+  // more than its ports give in a clock.
+  //
+  // Pixel s is written to entry s % lbSize, and reads are issued in the
+  // same step: a tap that is pixel s itself is forwarded from the input,
+  // and a read of the entry being overwritten gets the old contents, as
+  // with a read-first RAM.
+  static inline
+  BankSimReport simulateBanks(const BankedLineBuffer& lb) {
+    const int numRAMs = lb.numRAMs();
+    const int fill = (lb.windowRows - 1)*lb.imageCols + lb.windowCols;
+    const long numPixels = (long) lb.imageRows*lb.imageCols;
+
+    BankSimReport report;
+    report.banks.resize(numRAMs);
+
+    vector<int> stepReads(numRAMs);
+    vector<int> stepWrites(numRAMs);
+
+    RAMAddr writeAddr = lb.ramAddress(0);
+    int writeEntry = 0;
+
+    for (long s = 0; s < numPixels; s++) {
+      fill_n(stepReads.begin(), numRAMs, 0);
+      fill_n(stepWrites.begin(), numRAMs, 0);
+
+      stepWrites[writeAddr.ramNumber]++;
+
+      auto readPixel = [&](const long p) {
+        assert(p >= s - lb.lbSize);
+        if (p == s) {
+          report.forwardedReads++;
+        } else {
+          stepReads[lb.ramAddress(p % lb.lbSize).ramNumber]++;
+        }
+      };
+
+      // The window whose bottom right tap is pixel s.
+      const long topLeft = s - fill + 1;
+      if (topLeft >= 0) {
+        const int topLeftCol = topLeft % lb.imageCols;
+        const bool valid =
+          topLeftCol <= lb.imageCols - lb.windowCols &&
+          topLeft / lb.imageCols <= lb.imageRows - lb.windowRows;
+
+        if (lb.reads == FULL_WINDOW && valid) {
+          for (int r = 0; r < lb.windowRows; r++) {
+            for (int c = 0; c < lb.windowCols; c++) {
+              readPixel(topLeft + (long) r*lb.imageCols + c);
+            }
+          }
+        } else if (lb.reads == REGISTER_WINDOW) {
+          for (int r = 0; r < lb.windowRows; r++) {
+            readPixel(topLeft + (long) r*lb.imageCols + lb.windowCols - 1);
+          }
+        }
+
+        if (valid) {
+          report.outputs++;
+        }
+      }
+
+      int cycles = 1;
+      for (int b = 0; b < numRAMs; b++) {
+        BankStats& bank = report.banks[b];
+        bank.reads += stepReads[b];
+        bank.writes += stepWrites[b];
+        bank.peakReads = max(bank.peakReads, stepReads[b]);
+        bank.peakWrites = max(bank.peakWrites, stepWrites[b]);
+
+        const int needed = bankCycles(lb.ports, stepReads[b], stepWrites[b]);
+        if (needed > 1) {
+          bank.conflicts++;
+        }
+        cycles = max(cycles, needed);
+      }
+
+      if (cycles > 1) {
+        report.conflictPixels++;
+        report.stallCycles += cycles - 1;
+      }
+      report.cycles += cycles;
+      report.pixels++;
+
+      writeEntry++;
+      if (writeEntry == lb.lbSize) {
+        writeEntry = 0;
+        writeAddr = lb.ramAddress(0);
+      } else {
+        writeAddr = increment(writeAddr);
+      }
+    }
+
+    return report;
+  }
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace swlb {
+
+  enum CacheLevel {
+    L1_CACHE,
+    L2_CACHE,
+    L3_CACHE
+  };
+
+  // L2 size assumed when the machine does not report one.
+  const int DEFAULT_L2_BYTES = 256*1024;
+
+  class CacheInfo {
+  public:
+    int l1dBytes;
+    int l2Bytes;
+    int l3Bytes;
+
+    CacheInfo() : l1dBytes(0), l2Bytes(0), l3Bytes(0) {}
+
+    int bytes(const CacheLevel level) const {
+      if (level == L1_CACHE) {
+        return l1dBytes;
+      } else if (level == L2_CACHE) {
+        return l2Bytes;
+      }
+
+      return l3Bytes;
+    }
+  };
+
+  // Parses sysfs cache sizes such as "48K", "2048K" or "8M". Returns 0 if
+  // the string is not a size.
+  static inline
+  int parseCacheSize(const string& str) {
+    istringstream in(str);
+    long size = 0;
+    if (!(in >> size)) {
+      return 0;
+    }
+
+    char unit = 0;
+    in >> unit;
+    if (unit == 'K') {
+      size *= 1024;
+    } else if (unit == 'M') {
+      size *= 1024*1024;
+    } else if (unit == 'G') {
+      size *= 1024*1024*1024;
+    }
+
+    return size > 0x7fffffff ? 0x7fffffff : size;
+  }
+
+  static inline
+  string readSysfsLine(const string& path) {
+    ifstream in(path);
+    string line;
+    getline(in, line);
+    return line;
+  }
+
+  // Reads data and unified cache sizes of cpu0 from sysfs, falling back to
+  // sysconf and then to conservative defaults for anything still unknown.
+  static inline
+  CacheInfo detectCacheInfo() {
+    CacheInfo info;
+
+    for (int index = 0; index < 16; index++) {
+      string dir = "/sys/devices/system/cpu/cpu0/cache/index" + to_string(index) + "/";
+      string level = readSysfsLine(dir + "level");
+      if (level.empty()) {
+        break;
+      }
+
+      if (readSysfsLine(dir + "type") == "Instruction") {
+        continue;
+      }
+
+      int size = parseCacheSize(readSysfsLine(dir + "size"));
+      if (level == "1") {
+        info.l1dBytes = size;
+      } else if (level == "2") {
+        info.l2Bytes = size;
+      } else if (level == "3") {
+        info.l3Bytes = size;
+      }
+    }
+
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    if (info.l1dBytes <= 0) {
+      info.l1dBytes = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    }
+    if (info.l2Bytes <= 0) {
+      info.l2Bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    }
+    if (info.l3Bytes <= 0) {
+      info.l3Bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    }
+#endif
+
+    if (info.l1dBytes <= 0) {
+      info.l1dBytes = 32*1024;
+    }
+    if (info.l2Bytes <= 0) {
+      info.l2Bytes = DEFAULT_L2_BYTES;
+    }
+    if (info.l3Bytes <= 0) {
+      info.l3Bytes = info.l2Bytes;
+    }
+
+    return info;
+  }
+
+  // Cache sizes of the machine we are running on, detected once.
+  inline
+  const CacheInfo& hostCacheInfo() {
+    static const CacheInfo info = detectCacheInfo();
+    return info;
+  }
+
+  // Bytes of line buffer plus kernel needed to convolve a tile of
+  // tileCols output columns.
+  constexpr int tileWorkingSetBytes(const int elemBytes,
+                                    const int kernelRows,
+                                    const int kernelCols,
+                                    const int tileCols) {
+    return ((kernelRows - 1)*(tileCols + 2*(kernelCols / 2)) + (kernelCols / 2) + kernelCols + kernelRows*kernelCols)*elemBytes;
+  }
+
+  // Largest power of two tile width, no smaller than tileCols, whose
+  // working set fits in cacheBytes.
+  constexpr int cacheTileCols(const int elemBytes,
+                              const int kernelRows,
+                              const int kernelCols,
+                              const int cacheBytes,
+                              const int tileCols = 8) {
+    return tileWorkingSetBytes(elemBytes, kernelRows, kernelCols, 2*tileCols) > cacheBytes ?
+      tileCols :
+      cacheTileCols(elemBytes, kernelRows, kernelCols, cacheBytes, 2*tileCols);
+  }
+
+  // Picks the column strip width for the strip and tiled executors so that
+  // a strip's line buffer stays within a byte budget, normally half of a
+  // cache level so the rows streaming through have room too.
+  class StripPlanner {
+
+    int budgetBytes;
+
+  public:
+
+    StripPlanner(const int budgetBytes_) : budgetBytes(budgetBytes_) {}
+
+    int budget() const {
+      return budgetBytes;
+    }
+
+    bool unlimited() const {
+      return budgetBytes <= 0;
+    }
+
+    // Returns numOutCols when a full width line buffer fits, otherwise the
+    // widest power of two strip that does.
+    int stripCols(const int elemBytes,
+                  const int kernelRows,
+                  const int kernelCols,
+                  const int numOutCols) const {
+      if (unlimited() ||
+          tileWorkingSetBytes(elemBytes, kernelRows, kernelCols, numOutCols) <= budgetBytes) {
+        return numOutCols;
+      }
+
+      return min(cacheTileCols(elemBytes, kernelRows, kernelCols, budgetBytes), numOutCols);
+    }
+
+    static StripPlanner forCache(const CacheLevel level) {
+      return StripPlanner(hostCacheInfo().bytes(level) / 2);
+    }
+
+    // Never splits columns: every strip is the full image width.
+    static StripPlanner fullWidth() {
+      return StripPlanner(0);
+    }
+
+    // The default used by the executors: half of this machine's L2.
+    static const StripPlanner& host() {
+      static const StripPlanner planner = forCache(L2_CACHE);
+      return planner;
+    }
+  };
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "lb.h"
+
+using namespace std;
+
+namespace swlb {
+
+  // One kernel per channel of an interleaved image. Constructing from a
+  // single kernel shares it between all channels.
+  template<typename ElemType, int NumChannels, int NumKernelRows, int NumKernelCols>
+  class ChannelKernels {
+
+    Mem2D<ElemType, NumKernelRows, NumKernelCols> kernels[NumChannels];
+
+  public:
+
+    ChannelKernels() {}
+
+    ChannelKernels(const Mem2D<ElemType, NumKernelRows, NumKernelCols>& shared) {
+      for (int c = 0; c < NumChannels; c++) {
+        kernels[c] = shared;
+      }
+    }
+
+    void set(const int channel, const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) {
+      kernels[channel] = kernel;
+    }
+
+    const Mem2D<ElemType, NumKernelRows, NumKernelCols>& operator[](const int channel) const {
+      return kernels[channel];
+    }
+  };
+
+  // Routes an interleaved stream of output samples to one sink per
+  // channel, for planar output.
+  template<typename Sink, int NumChannels>
+  class PlanarChannelSink {
+
+    Sink* sinks[NumChannels];
+    int channel;
+
+  public:
+
+    PlanarChannelSink(Sink* const channelSinks[NumChannels]) : channel(0) {
+      for (int c = 0; c < NumChannels; c++) {
+        sinks[c] = channelSinks[c];
+      }
+    }
+
+    template<typename ElemType>
+    void write(const ElemType value) {
+      sinks[channel]->write(value);
+      channel = channel + 1 == NumChannels ? 0 : channel + 1;
+    }
+  };
+
+  // Convolves each channel of an interleaved image (RGB, RGBA, ...) with
+  // its own kernel without deinterleaving it first. The line buffer holds
+  // rows of NumImageCols*NumChannels samples as they arrive, and a window
+  // centered on a sample reads taps NumChannels samples apart, so every
+  // tap lands on the same channel as the center. The samples of pixels the
+  // kernel cannot cover fall outside the output bounds like any other
+  // margin, so each input sample is written once and each valid output
+  // sample is produced in interleaved order.
+  //
+  // Source yields interleaved samples like lineBufferConvStream's. Sink
+  // receives interleaved samples; wrap it in a PlanarChannelSink for
+  // planar output.
+  template<typename ElemType, int NumChannels, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvChannels(Source& input,
+                              const ChannelKernels<ElemType, NumChannels, NumKernelRows, NumKernelCols>& kernels,
+                              Sink& lbOutput) {
+
+    const int WINDOW_COLS = (NumKernelCols - 1)*NumChannels + 1;
+
+    ImageBuffer<int, NumKernelRows, WINDOW_COLS, NumImageRows, NumImageCols*NumChannels> lb;
+
+    while (!lb.windowValid()) {
+      lb.write(input.read());
+      input.pop();
+    }
+
+    // The first valid center is channel 0 of a pixel and valid centers run
+    // in whole pixels, so the channel just cycles.
+    int channel = 0;
+
+    while (true) {
+
+      if (lb.windowValid()) {
+        const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel = kernels[channel];
+
+        int res = 0;
+        for (int row = 0; row < NumKernelRows; row++) {
+          for (int col = 0; col < NumKernelCols; col++) {
+            res += kernel(row, col)*lb.read(row - (NumKernelRows / 2), (col - (NumKernelCols / 2))*NumChannels);
+          }
+        }
+
+        lbOutput.write(res);
+        channel = channel + 1 == NumChannels ? 0 : channel + 1;
+      }
+
+      if (input.isEmpty()) {
+        break;
+      }
+
+      lb.pop();
+      lb.write(input.read());
+
+      input.pop();
+    }
+  }
+
+  template<typename ElemType, int NumChannels, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvChannelsPlanar(Source& input,
+                                    const ChannelKernels<ElemType, NumChannels, NumKernelRows, NumKernelCols>& kernels,
+                                    Sink* const channelOutputs[NumChannels]) {
+    PlanarChannelSink<Sink, NumChannels> planar(channelOutputs);
+    lineBufferConvChannels<ElemType, NumChannels, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(input, kernels, planar);
+  }
+
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "lb.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace swlb {
+
+  // The color of the top left 2x2 block of the color filter array, read
+  // left to right, top to bottom.
+  enum CfaPhase {
+    CFA_RGGB,
+    CFA_BGGR,
+    CFA_GRBG,
+    CFA_GBRG
+  };
+
+  enum CfaColor {
+    CFA_RED,
+    CFA_GREEN,
+    CFA_BLUE
+  };
+
+  // The four kinds of sample in a Bayer mosaic. Green samples differ by
+  // whether red neighbors them horizontally (a red row) or vertically.
+  enum CfaSite {
+    SITE_RED,
+    SITE_GREEN_RED_ROW,
+    SITE_GREEN_BLUE_ROW,
+    SITE_BLUE,
+    NUM_CFA_SITES
+  };
+
+  // parity is (row & 1) << 1 | (col & 1).
+  inline CfaColor cfaColor(const CfaPhase phase, const int parity) {
+    const CfaColor colors[4][4] = {
+      {CFA_RED, CFA_GREEN, CFA_GREEN, CFA_BLUE},
+      {CFA_BLUE, CFA_GREEN, CFA_GREEN, CFA_RED},
+      {CFA_GREEN, CFA_RED, CFA_BLUE, CFA_GREEN},
+      {CFA_GREEN, CFA_BLUE, CFA_RED, CFA_GREEN}
+    };
+    return colors[phase][parity];
+  }
+
+  inline CfaSite cfaSite(const CfaPhase phase, const int parity) {
+    CfaColor c = cfaColor(phase, parity);
+    if (c == CFA_RED) {
+      return SITE_RED;
+    }
+    if (c == CFA_BLUE) {
+      return SITE_BLUE;
+    }
+    return cfaColor(phase, parity ^ 1) == CFA_RED ? SITE_GREEN_RED_ROW : SITE_GREEN_BLUE_ROW;
+  }
+
+  // Fixed point demosaic kernels: for each site and each output color a
+  // KernelSize x KernelSize kernel whose taps sum to DEMOSAIC_SCALE.
+  const int DEMOSAIC_SHIFT = 4;
+  const int DEMOSAIC_SCALE = 1 << DEMOSAIC_SHIFT;
+
+  template<int KernelSize>
+  class DemosaicKernels {
+
+    Mem2D<int, KernelSize, KernelSize> taps[NUM_CFA_SITES][3];
+
+    // Sets a kernel from the centered KernelSize x KernelSize part of a 5x5
+    // pattern.
+    void set(const CfaSite site, const CfaColor color, const int pattern[5][5]) {
+      const int off = 2 - KernelSize / 2;
+      for (int i = 0; i < KernelSize; i++) {
+        for (int j = 0; j < KernelSize; j++) {
+          taps[site][color].set(i, j, pattern[i + off][j + off]);
+        }
+      }
+    }
+
+  public:
+
+    // Fills in every kernel from the three interpolating patterns, given
+    // centered in 5x5 and in units of 1/DEMOSAIC_SCALE. The kernels for
+    // the other color at a green site are transposes, and each site's own
+    // color is the identity.
+    void build(const int green[5][5], const int horizontal[5][5], const int diagonal[5][5]) {
+      int identity[5][5] = {};
+      identity[2][2] = DEMOSAIC_SCALE;
+
+      int vertical[5][5];
+      for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 5; j++) {
+          vertical[i][j] = horizontal[j][i];
+        }
+      }
+
+      set(SITE_RED, CFA_RED, identity);
+      set(SITE_RED, CFA_GREEN, green);
+      set(SITE_RED, CFA_BLUE, diagonal);
+
+      set(SITE_BLUE, CFA_BLUE, identity);
+      set(SITE_BLUE, CFA_GREEN, green);
+      set(SITE_BLUE, CFA_RED, diagonal);
+
+      set(SITE_GREEN_RED_ROW, CFA_GREEN, identity);
+      set(SITE_GREEN_RED_ROW, CFA_RED, horizontal);
+      set(SITE_GREEN_RED_ROW, CFA_BLUE, vertical);
+
+      set(SITE_GREEN_BLUE_ROW, CFA_GREEN, identity);
+      set(SITE_GREEN_BLUE_ROW, CFA_BLUE, horizontal);
+      set(SITE_GREEN_BLUE_ROW, CFA_RED, vertical);
+    }
+
+    const Mem2D<int, KernelSize, KernelSize>& operator()(const CfaSite site, const CfaColor color) const {
+      return taps[site][color];
+    }
+  };
+
+  // Averages of the nearest samples of each color.
+  inline DemosaicKernels<3> bilinearDemosaicKernels() {
+    const int green[5][5] = {
+      {0, 0, 0, 0, 0},
+      {0, 0, 4, 0, 0},
+      {0, 4, 0, 4, 0},
+      {0, 0, 4, 0, 0},
+      {0, 0, 0, 0, 0}
+    };
+    const int horizontal[5][5] = {
+      {0, 0, 0, 0, 0},
+      {0, 0, 0, 0, 0},
+      {0, 8, 0, 8, 0},
+      {0, 0, 0, 0, 0},
+      {0, 0, 0, 0, 0}
+    };
+    const int diagonal[5][5] = {
+      {0, 0, 0, 0, 0},
+      {0, 4, 0, 4, 0},
+      {0, 0, 0, 0, 0},
+      {0, 4, 0, 4, 0},
+      {0, 0, 0, 0, 0}
+    };
+
+    DemosaicKernels<3> k;
+    k.build(green, horizontal, diagonal);
+    return k;
+  }
+
+  // Malvar, He and Cutler, "High-quality linear interpolation for
+  // demosaicing of Bayer-patterned color images", ICASSP 2004: bilinear
+  // plus a Laplacian correction from the center sample's own color.
+  inline DemosaicKernels<5> malvarHeCutlerKernels() {
+    const int green[5][5] = {
+      {0, 0, -2, 0, 0},
+      {0, 0, 4, 0, 0},
+      {-2, 4, 8, 4, -2},
+      {0, 0, 4, 0, 0},
+      {0, 0, -2, 0, 0}
+    };
+    const int horizontal[5][5] = {
+      {0, 0, 1, 0, 0},
+      {0, -2, 0, -2, 0},
+      {-2, 8, 10, 8, -2},
+      {0, -2, 0, -2, 0},
+      {0, 0, 1, 0, 0}
+    };
+    const int diagonal[5][5] = {
+      {0, 0, -3, 0, 0},
+      {0, 4, 0, 4, 0},
+      {-3, 0, 12, 0, -3},
+      {0, 4, 0, 4, 0},
+      {0, 0, -3, 0, 0}
+    };
+
+    DemosaicKernels<5> k;
+    k.build(green, horizontal, diagonal);
+    return k;
+  }
+
+  // Demosaics a row major Bayer stream through one ImageBuffer, writing
+  // R, G, B for every pixel of the valid region (the border the kernel
+  // cannot cover is dropped, as in lineBufferConv). Results are rounded
+  // and clamped to [0, maxValue].
+  //
+  // The kernels for each of the four pixel parities are looked up once up
+  // front, so the inner loop indexes a table by the center's parity
+  // instead of branching on the CFA phase or site.
+  //
+  // Sink receives interleaved RGB; wrap it in a PlanarChannelSink for
+  // planar output.
+  template<int KernelSize, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferDemosaic(Source& input,
+                          const DemosaicKernels<KernelSize>& kernels,
+                          const CfaPhase phase,
+                          const int maxValue,
+                          Sink& output) {
+
+    const int MARGIN = KernelSize / 2;
+
+    const Mem2D<int, KernelSize, KernelSize>* byParity[4][3];
+    for (int parity = 0; parity < 4; parity++) {
+      for (int c = 0; c < 3; c++) {
+        byParity[parity][c] = &kernels(cfaSite(phase, parity), (CfaColor) c);
+      }
+    }
+
+    ImageBuffer<int, KernelSize, KernelSize, NumImageRows, NumImageCols> lb;
+
+    while (!lb.windowValid()) {
+      lb.write(input.read());
+      input.pop();
+    }
+
+    while (true) {
+
+      if (lb.windowValid()) {
+        int window[KernelSize][KernelSize];
+        for (int row = 0; row < KernelSize; row++) {
+          for (int col = 0; col < KernelSize; col++) {
+            window[row][col] = lb.read(row - MARGIN, col - MARGIN);
+          }
+        }
+
+        PixelLoc center = lb.nextReadCenter();
+        const int parity = ((center.row & 1) << 1) | (center.col & 1);
+
+        for (int c = 0; c < 3; c++) {
+          const Mem2D<int, KernelSize, KernelSize>& kernel = *byParity[parity][c];
+
+          int res = DEMOSAIC_SCALE / 2;
+          for (int row = 0; row < KernelSize; row++) {
+            for (int col = 0; col < KernelSize; col++) {
+              res += kernel(row, col)*window[row][col];
+            }
+          }
+
+          output.write(min(max(res >> DEMOSAIC_SHIFT, 0), maxValue));
+        }
+      }
+
+      if (input.isEmpty()) {
+        break;
+      }
+
+      lb.pop();
+      lb.write(input.read());
+
+      input.pop();
+    }
+  }
+
+}
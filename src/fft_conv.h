@@ -0,0 +1,243 @@
+#pragma once
+
+#include "lb.h"
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  // (a*b) written out: std::complex's operator* checks for infinities
+  // and NaNs through a library call, which the butterflies cannot afford.
+  static inline
+  complex<double> mulComplex(const complex<double> a, const complex<double> b) {
+    return complex<double>(a.real()*b.real() - a.imag()*b.imag(),
+                           a.real()*b.imag() + a.imag()*b.real());
+  }
+
+  static inline
+  int nextPowerOfTwo(const int n) {
+    int p = 1;
+    while (p < n) {
+      p *= 2;
+    }
+    return p;
+  }
+
+  // An in place radix-2 FFT of a fixed power of two size, with the bit
+  // reversal and twiddle factors computed once. Neither direction scales
+  // its output, so a forward and inverse transform multiply by size().
+  class FFT {
+
+    int n;
+    vector<int> reversed;
+    vector<complex<double> > twiddles;
+
+  public:
+
+    FFT(const int n_) : n(n_), reversed(n_), twiddles(n_ / 2) {
+      assert(n > 0 && (n & (n - 1)) == 0);
+
+      int bits = 0;
+      while ((1 << bits) < n) {
+        bits++;
+      }
+      for (int i = 0; i < n; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+          r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        reversed[i] = r;
+      }
+
+      for (int k = 0; k < n / 2; k++) {
+        const double angle = -2*M_PI*k / n;
+        twiddles[k] = complex<double>(cos(angle), sin(angle));
+      }
+    }
+
+    int size() const {
+      return n;
+    }
+
+    complex<double> twiddle(const int k, const bool inverse) const {
+      return inverse ? conj(twiddles[k]) : twiddles[k];
+    }
+
+    void transform(complex<double>* x, const bool inverse) const {
+      for (int i = 0; i < n; i++) {
+        if (i < reversed[i]) {
+          swap(x[i], x[reversed[i]]);
+        }
+      }
+
+      for (int len = 2; len <= n; len *= 2) {
+        const int half = len / 2;
+        const int step = n / len;
+        for (int i = 0; i < n; i += len) {
+          for (int k = 0; k < half; k++) {
+            const complex<double> u = x[i + k];
+            const complex<double> v = mulComplex(x[i + k + half], twiddle(k*step, inverse));
+            x[i + k] = u + v;
+            x[i + k + half] = u - v;
+          }
+        }
+      }
+    }
+
+    // Transforms every column of a size() x cols row major grid. Each
+    // butterfly combines two whole rows, so the grid is walked row by row
+    // instead of with a stride of cols per element.
+    void transformColumns(complex<double>* grid, const int cols, const bool inverse) const {
+      for (int i = 0; i < n; i++) {
+        if (i < reversed[i]) {
+          swap_ranges(grid + i*cols, grid + (i + 1)*cols, grid + reversed[i]*cols);
+        }
+      }
+
+      for (int len = 2; len <= n; len *= 2) {
+        const int half = len / 2;
+        const int step = n / len;
+        for (int i = 0; i < n; i += len) {
+          for (int k = 0; k < half; k++) {
+            const complex<double> w = twiddle(k*step, inverse);
+            complex<double>* a = grid + (i + k)*cols;
+            complex<double>* b = grid + (i + k + half)*cols;
+            for (int j = 0; j < cols; j++) {
+              const complex<double> u = a[j];
+              const complex<double> v = mulComplex(b[j], w);
+              a[j] = u + v;
+              b[j] = u - v;
+            }
+          }
+        }
+      }
+    }
+  };
+
+  // Rows per FFT strip for a kernel of kernelRows rows: each strip
+  // overlaps the one before by kernelRows - 1 rows, so strips are made a
+  // few times taller than that to keep most of every transform useful,
+  // but never taller than the image needs.
+  static inline
+  int fftStripRows(const int kernelRows, const int imageRows) {
+    const int rows = max(32, nextPowerOfTwo(4*(kernelRows - 1)));
+    return min(rows, nextPowerOfTwo(imageRows));
+  }
+
+  // Convolves a row major pixel stream in the frequency domain, for large
+  // kernels where the direct multiply-accumulate costs
+  // NumKernelRows*NumKernelCols per pixel and this costs a few times
+  // log2 of the transform size.
+  //
+  // The image is cut into horizontal strips, each transformed as a
+  // fftStripRows() x nextPowerOfTwo(NumImageCols) grid and multiplied by
+  // the kernel's spectrum (overlap-save): every strip starts with the last
+  // NumKernelRows - 1 input rows of the one before, and the outputs that
+  // wrapped around in the circular convolution are dropped. Two strips are
+  // transformed at once, one as the real part and one as the imaginary
+  // part, which the real kernel keeps apart. Memory is proportional to the
+  // strip height, not the frame height.
+  //
+  // Source, Sink and the output layout are those of lineBufferConvStream.
+  // Integer results are rounded back exactly as long as the sums stay well
+  // inside double precision.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvFFT(Source& input,
+                         const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                         Sink& lbOutput) {
+
+    const int OUT_ROWS = NumImageRows - NumKernelRows + 1;
+    const int OUT_COLS = NumImageCols - NumKernelCols + 1;
+
+    const int P = fftStripRows(NumKernelRows, NumImageRows);
+    const int Q = nextPowerOfTwo(NumImageCols);
+    const int STRIP_OUT_ROWS = P - NumKernelRows + 1;
+
+    const FFT rowFFT(Q);
+    const FFT colFFT(P);
+
+    // The kernel is flipped so the circular convolution computes the same
+    // correlation as bulkConv, and the inverse transform's scale is folded
+    // into its spectrum.
+    vector<complex<double> > spectrum(P*Q);
+    for (int r = 0; r < NumKernelRows; r++) {
+      for (int c = 0; c < NumKernelCols; c++) {
+        spectrum[(NumKernelRows - 1 - r)*Q + (NumKernelCols - 1 - c)] = kernel(r, c);
+      }
+    }
+    for (int r = 0; r < NumKernelRows; r++) {
+      rowFFT.transform(&spectrum[r*Q], false);
+    }
+    colFFT.transformColumns(&spectrum[0], Q, false);
+    for (int i = 0; i < P*Q; i++) {
+      spectrum[i] /= (double) P*Q;
+    }
+
+    // Input rows for two strips: the overlap, then 2*STRIP_OUT_ROWS new
+    // ones.
+    const int WINDOW_ROWS = NumKernelRows - 1 + 2*STRIP_OUT_ROWS;
+    vector<double> window(WINDOW_ROWS*NumImageCols);
+    vector<complex<double> > grid(P*Q);
+
+    for (int i = 0; i < (NumKernelRows - 1)*NumImageCols; i++) {
+      window[i] = input.read();
+      input.pop();
+    }
+
+    int outRow = 0;
+    while (outRow < OUT_ROWS) {
+      const int newRows = min(2*STRIP_OUT_ROWS, OUT_ROWS - outRow);
+      const int filledRows = NumKernelRows - 1 + newRows;
+
+      for (int i = (NumKernelRows - 1)*NumImageCols; i < filledRows*NumImageCols; i++) {
+        window[i] = input.read();
+        input.pop();
+      }
+      fill(window.begin() + filledRows*NumImageCols, window.end(), 0.0);
+
+      for (int r = 0; r < P; r++) {
+        const double* a = &window[r*NumImageCols];
+        const double* b = &window[(r + STRIP_OUT_ROWS)*NumImageCols];
+        complex<double>* row = &grid[r*Q];
+        for (int j = 0; j < NumImageCols; j++) {
+          row[j] = complex<double>(a[j], b[j]);
+        }
+        fill(row + NumImageCols, row + Q, complex<double>(0, 0));
+        rowFFT.transform(row, false);
+      }
+
+      colFFT.transformColumns(&grid[0], Q, false);
+      for (int i = 0; i < P*Q; i++) {
+        grid[i] = mulComplex(grid[i], spectrum[i]);
+      }
+      colFFT.transformColumns(&grid[0], Q, true);
+
+      // Only the rows that did not wrap around are needed back.
+      for (int r = NumKernelRows - 1; r < P; r++) {
+        rowFFT.transform(&grid[r*Q], true);
+      }
+
+      const int firstRows = min(STRIP_OUT_ROWS, newRows);
+      for (int i = 0; i < firstRows; i++) {
+        const complex<double>* row = &grid[(i + NumKernelRows - 1)*Q + NumKernelCols - 1];
+        for (int j = 0; j < OUT_COLS; j++) {
+          lbOutput.write((int) lround(row[j].real()));
+        }
+      }
+      for (int i = 0; i < newRows - firstRows; i++) {
+        const complex<double>* row = &grid[(i + NumKernelRows - 1)*Q + NumKernelCols - 1];
+        for (int j = 0; j < OUT_COLS; j++) {
+          lbOutput.write((int) lround(row[j].imag()));
+        }
+      }
+
+      copy(window.begin() + newRows*NumImageCols, window.begin() + filledRows*NumImageCols, window.begin());
+      outRow += newRows;
+    }
+  }
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "channels.h"
+#include "lb.h"
+
+using namespace std;
+
+namespace swlb {
+
+  // NumKernels kernels of one size applied to the same image, such as
+  // Sobel X and Y or a bank of Gabor filters.
+  template<typename ElemType, int NumKernels, int NumKernelRows, int NumKernelCols>
+  class FilterBank {
+
+    Mem2D<ElemType, NumKernelRows, NumKernelCols> kernels[NumKernels];
+
+  public:
+
+    void set(const int k, const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) {
+      kernels[k] = kernel;
+    }
+
+    const Mem2D<ElemType, NumKernelRows, NumKernelCols>& operator[](const int k) const {
+      return kernels[k];
+    }
+  };
+
+  // Convolves a row major pixel stream with every kernel of a bank in one
+  // pass. Each window is read out of the line buffer once into locals and
+  // all NumKernels dot products run on that copy, so the input is streamed
+  // and buffered once instead of once per kernel.
+  //
+  // Source and Sink are as for lineBufferConvStream. Sink receives the
+  // NumKernels results of each pixel in kernel order; wrap it in a
+  // PlanarChannelSink, or use lineBufferConvBankPlanar, for one stream per
+  // kernel.
+  template<typename ElemType, int NumKernels, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvBank(Source& input,
+                          const FilterBank<ElemType, NumKernels, NumKernelRows, NumKernelCols>& bank,
+                          Sink& lbOutput) {
+
+    ImageBuffer<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols> lb;
+
+    while (!lb.windowValid()) {
+      lb.write(input.read());
+      input.pop();
+    }
+
+    while (true) {
+
+      if (lb.windowValid()) {
+        int window[NumKernelRows][NumKernelCols];
+        for (int row = 0; row < NumKernelRows; row++) {
+          for (int col = 0; col < NumKernelCols; col++) {
+            window[row][col] = lb.read(row - (NumKernelRows / 2), col - (NumKernelCols / 2));
+          }
+        }
+
+        for (int k = 0; k < NumKernels; k++) {
+          const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel = bank[k];
+
+          int res = 0;
+          for (int row = 0; row < NumKernelRows; row++) {
+            for (int col = 0; col < NumKernelCols; col++) {
+              res += kernel(row, col)*window[row][col];
+            }
+          }
+
+          lbOutput.write(res);
+        }
+      }
+
+      if (input.isEmpty()) {
+        break;
+      }
+
+      lb.pop();
+      lb.write(input.read());
+
+      input.pop();
+    }
+  }
+
+  template<typename ElemType, int NumKernels, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvBankPlanar(Source& input,
+                                const FilterBank<ElemType, NumKernels, NumKernelRows, NumKernelCols>& bank,
+                                Sink* const outputs[NumKernels]) {
+    PlanarChannelSink<Sink, NumKernels> planar(outputs);
+    lineBufferConvBank<ElemType, NumKernels, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(input, bank, planar);
+  }
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "cache_planner.h"
+#include "lb.h"
+
+#include <climits>
+
+using namespace std;
+
+namespace swlb {
+
+  // Deepest configuration of an 18Kb block RAM, one bit wide.
+  const int BRAM18_MAX_DEPTH = 16*1024;
+
+  // Arrays this small go to LUTs or registers rather than block RAM.
+  const int LUTRAM_MAX_BITS = 1024;
+
+  // Widest word an 18Kb block RAM holds at the given depth.
+  constexpr int bram18Width(const long depth) {
+    return depth <= 512 ? 36 :
+      depth <= 1024 ? 18 :
+      depth <= 2048 ? 9 :
+      depth <= 4096 ? 4 :
+      depth <= 8192 ? 2 : 1;
+  }
+
+  // 18Kb block RAMs needed for one memory of depth words of bits each.
+  constexpr int bram18Count(const long depth, const int bits) {
+    return depth*bits <= LUTRAM_MAX_BITS ? 0 :
+      depth > BRAM18_MAX_DEPTH ? (int) ((depth + BRAM18_MAX_DEPTH - 1) / BRAM18_MAX_DEPTH)*bits :
+      (bits + bram18Width(depth) - 1) / bram18Width(depth);
+  }
+
+  // Storage of a buffer: bytes is its sizeof, lines the full width row
+  // memories it holds (image lines or frame rows), registers the elements
+  // kept outside them (short lines, window registers and kernel
+  // coefficients) and brams the 18Kb block RAMs it needs in hardware, with
+  // one RAM per line.
+  class Footprint {
+  public:
+    long bytes;
+    int lines;
+    int registers;
+    int brams;
+
+    constexpr Footprint() : bytes(0), lines(0), registers(0), brams(0) {}
+
+    constexpr Footprint(const long bytes_, const int lines_, const int registers_, const int brams_) :
+      bytes(bytes_), lines(lines_), registers(registers_), brams(brams_) {}
+
+    constexpr Footprint operator+(const Footprint& other) const {
+      return Footprint(bytes + other.bytes,
+                       lines + other.lines,
+                       registers + other.registers,
+                       brams + other.brams);
+    }
+  };
+
+  template<typename Buffer>
+  class StorageFootprint {};
+
+  // A frame, stored one row per memory.
+  template<typename ElemType, int NumRows, int NumCols>
+  class StorageFootprint<Mem2D<ElemType, NumRows, NumCols> > {
+  public:
+    static constexpr Footprint value() {
+      return Footprint(sizeof(Mem2D<ElemType, NumRows, NumCols>),
+                       NumRows,
+                       0,
+                       NumRows*bram18Count(NumCols, 8*sizeof(ElemType)));
+    }
+  };
+
+  template<typename ElemType, int size>
+  class StorageFootprint<CircularFIFO<ElemType, size> > {
+  public:
+    static constexpr Footprint value() {
+      return Footprint(sizeof(CircularFIFO<ElemType, size>),
+                       0,
+                       0,
+                       bram18Count(size, 8*sizeof(ElemType)));
+    }
+  };
+
+  // WindowRows - 1 full lines plus the short line the window's bottom row
+  // is read out of.
+  template<typename ElemType, int WindowRows, int WindowCols, int NumImageRows, int NumImageCols>
+  class StorageFootprint<ImageBuffer<ElemType, WindowRows, WindowCols, NumImageRows, NumImageCols> > {
+  public:
+    static constexpr Footprint value() {
+      return Footprint(sizeof(ImageBuffer<ElemType, WindowRows, WindowCols, NumImageRows, NumImageCols>),
+                       WindowRows - 1,
+                       (WindowCols / 2) + WindowCols,
+                       (WindowRows - 1)*bram18Count(NumImageCols, 8*sizeof(ElemType)));
+    }
+  };
+
+  // line0 and line1, with line2 and the nine window taps in registers.
+  template<typename ElemType, int NumImageRows, int NumImageCols>
+  class StorageFootprint<ImageBuffer3x3<ElemType, NumImageRows, NumImageCols> > {
+    typedef ImageBuffer3x3<ElemType, NumImageRows, NumImageCols> Buffer;
+
+  public:
+    static constexpr Footprint value() {
+      return Footprint(sizeof(Buffer),
+                       2,
+                       Buffer::WINDOW_COL_MARGIN + Buffer::WindowCols + Buffer::WindowRows*Buffer::WindowCols,
+                       2*bram18Count(NumImageCols, 8*sizeof(ElemType)));
+    }
+  };
+
+  template<typename Buffer>
+  constexpr Footprint storageFootprint() {
+    return StorageFootprint<Buffer>::value();
+  }
+
+  // Total storage of a pipeline built from the given buffers.
+  template<typename Stage>
+  constexpr Footprint pipelineFootprint() {
+    return storageFootprint<Stage>();
+  }
+
+  template<typename First, typename Second, typename... Rest>
+  constexpr Footprint pipelineFootprint() {
+    return storageFootprint<First>() + pipelineFootprint<Second, Rest...>();
+  }
+
+  // A kernel's coefficients, which sit in registers next to the window
+  // rather than in line memories.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols>
+  constexpr Footprint kernelFootprint() {
+    return Footprint(sizeof(Mem2D<ElemType, NumKernelRows, NumKernelCols>),
+                     0,
+                     NumKernelRows*NumKernelCols,
+                     0);
+  }
+
+  // The on chip storage of lineBufferConv: the line buffer, whose
+  // NumKernelRows - 1 lines are all the lines it needs, and the kernel.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  constexpr Footprint lineBufferConvFootprint() {
+    return storageFootprint<ImageBuffer<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols> >() +
+      kernelFootprint<ElemType, NumKernelRows, NumKernelCols>();
+  }
+
+  // A limit on bytes and block RAMs, usable in static_assert:
+  //
+  //   static_assert(cacheBudget(DEFAULT_L2_BYTES).admits(lineBufferConvFootprint<int, 5, 5, 1080, 1920>()),
+  //                 "5x5 line buffer does not fit in L2");
+  class FootprintBudget {
+  public:
+    long bytes;
+    int brams;
+
+    constexpr FootprintBudget(const long bytes_, const int brams_) : bytes(bytes_), brams(brams_) {}
+
+    constexpr bool admits(const Footprint& f) const {
+      return f.bytes <= bytes && f.brams <= brams;
+    }
+  };
+
+  constexpr FootprintBudget cacheBudget(const long bytes) {
+    return FootprintBudget(bytes, INT_MAX);
+  }
+
+  constexpr FootprintBudget bramBudget(const int brams) {
+    return FootprintBudget(LONG_MAX, brams);
+  }
+
+}
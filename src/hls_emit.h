@@ -0,0 +1,247 @@
+#pragma once
+
+#include "lb.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  // A line buffer convolution to be emitted as HLS C++: a windowRows x
+  // windowCols kernel with fixed coefficients (row major) over a
+  // imageRows x imageCols image of elemType samples.
+  class HlsConvConfig {
+  public:
+    string name;
+    string elemType;
+    int windowRows;
+    int windowCols;
+    int imageRows;
+    int imageCols;
+    vector<int> kernel;
+
+    int outRows() const {
+      return imageRows - 2*(windowRows / 2);
+    }
+
+    int outCols() const {
+      return imageCols - 2*(windowCols / 2);
+    }
+
+    int coeff(const int row, const int col) const {
+      return kernel[row*windowCols + col];
+    }
+  };
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  HlsConvConfig hlsConvConfig(const string& name,
+                              const string& elemType,
+                              const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) {
+    HlsConvConfig config;
+    config.name = name;
+    config.elemType = elemType;
+    config.windowRows = NumKernelRows;
+    config.windowCols = NumKernelCols;
+    config.imageRows = NumImageRows;
+    config.imageCols = NumImageCols;
+    for (int r = 0; r < NumKernelRows; r++) {
+      for (int c = 0; c < NumKernelCols; c++) {
+        config.kernel.push_back(kernel(r, c));
+      }
+    }
+    return config;
+  }
+
+  static inline
+  void emitHlsPrototype(ostream& out, const HlsConvConfig& config) {
+    out << "void " << config.name << "(const " << config.elemType << " in[" << config.imageRows*config.imageCols << "], "
+        << config.elemType << " out[" << config.outRows()*config.outCols() << "])";
+  }
+
+  // Writes the convolution as a synthesizable HLS top function taking the
+  // image as a stream in row major order and producing the outputs in
+  // lineBufferConv's order.
+  //
+  // The hardware is ImageBuffer3x3's, generalized: windowRows - 1 line
+  // RAMs of one image row each, partitioned so every row is its own RAM,
+  // and a fully partitioned register window. Each clock shifts the window
+  // left, reads the entering column from the line RAMs at the current
+  // column, and rotates the new pixel into them at the same address, so
+  // each RAM sees one read and one write per clock and the pixel loop
+  // pipelines at II=1 on simple dual port RAMs. Zero taps are left out of
+  // the multiply-accumulate.
+  static inline
+  void emitHlsConv(ostream& out, const HlsConvConfig& config) {
+    const int KR = config.windowRows;
+    const int KC = config.windowCols;
+    const int LINES = KR - 1;
+    const string& E = config.elemType;
+
+    out << "// " << config.windowRows << "x" << config.windowCols << " convolution of a "
+        << config.imageRows << "x" << config.imageCols << " image, generated by swlb::emitHlsConv." << endl;
+    out << endl;
+
+    emitHlsPrototype(out, config);
+    out << " {" << endl;
+    out << "#pragma HLS INTERFACE mode=axis port=in" << endl;
+    out << "#pragma HLS INTERFACE mode=axis port=out" << endl;
+    out << endl;
+
+    if (LINES > 0) {
+      out << "  static " << E << " lines[" << LINES << "][" << config.imageCols << "];" << endl;
+      out << "#pragma HLS ARRAY_PARTITION variable=lines complete dim=1" << endl;
+      out << "#pragma HLS BIND_STORAGE variable=lines type=ram_s2p" << endl;
+    }
+    out << "  static " << E << " window[" << KR << "][" << KC << "];" << endl;
+    out << "#pragma HLS ARRAY_PARTITION variable=window complete dim=0" << endl;
+    out << endl;
+
+    out << "  int row = 0;" << endl;
+    out << "  int col = 0;" << endl;
+    out << "  int outIndex = 0;" << endl;
+    out << endl;
+
+    out << "pixels:" << endl;
+    out << "  for (int i = 0; i < " << config.imageRows*config.imageCols << "; i++) {" << endl;
+    out << "#pragma HLS PIPELINE II=1" << endl;
+    out << "    const " << E << " pixel = in[i];" << endl;
+    out << endl;
+
+    out << "    for (int r = 0; r < " << KR << "; r++) {" << endl;
+    out << "#pragma HLS UNROLL" << endl;
+    out << "      for (int c = 0; c < " << KC - 1 << "; c++) {" << endl;
+    out << "#pragma HLS UNROLL" << endl;
+    out << "        window[r][c] = window[r][c + 1];" << endl;
+    out << "      }" << endl;
+    out << "    }" << endl;
+    out << endl;
+
+    for (int r = 0; r < LINES; r++) {
+      out << "    window[" << r << "][" << KC - 1 << "] = lines[" << r << "][col];" << endl;
+    }
+    out << "    window[" << KR - 1 << "][" << KC - 1 << "] = pixel;" << endl;
+    for (int r = 0; r + 1 < LINES; r++) {
+      out << "    lines[" << r << "][col] = window[" << r + 1 << "][" << KC - 1 << "];" << endl;
+    }
+    if (LINES > 0) {
+      out << "    lines[" << LINES - 1 << "][col] = pixel;" << endl;
+    }
+    out << endl;
+
+    out << "    if (row >= " << KR - 1 << " && col >= " << KC - 1 << ") {" << endl;
+    out << "      int acc = 0;" << endl;
+    for (int r = 0; r < KR; r++) {
+      for (int c = 0; c < KC; c++) {
+        const int k = config.coeff(r, c);
+        if (k == 0) {
+          continue;
+        }
+        out << "      acc += ";
+        if (k != 1) {
+          out << k << "*";
+        }
+        out << "window[" << r << "][" << c << "];" << endl;
+      }
+    }
+    out << "      out[outIndex] = acc;" << endl;
+    out << "      outIndex++;" << endl;
+    out << "    }" << endl;
+    out << endl;
+
+    out << "    col++;" << endl;
+    out << "    if (col == " << config.imageCols << ") {" << endl;
+    out << "      col = 0;" << endl;
+    out << "      row++;" << endl;
+    out << "    }" << endl;
+    out << "  }" << endl;
+    out << "}" << endl;
+  }
+
+  static inline
+  void emitHlsArray(ostream& out, const string& elemType, const string& name, const vector<int>& values, const int perLine) {
+    out << "static const " << elemType << " " << name << "[" << values.size() << "] = {";
+    for (size_t i = 0; i < values.size(); i++) {
+      out << (i % perLine == 0 ? "\n  " : " ") << values[i] << (i + 1 == values.size() ? "" : ",");
+    }
+    out << "\n};" << endl;
+  }
+
+  // Writes a C simulation testbench for emitHlsConv's function: it runs
+  // input through it for two frames in a row, since the line RAMs persist
+  // between calls, and compares every output with expected. It prints
+  // PASS and returns 0 when they all match.
+  static inline
+  void emitHlsTestbench(ostream& out,
+                        const HlsConvConfig& config,
+                        const vector<int>& input,
+                        const vector<int>& expected) {
+    const int OUT = config.outRows()*config.outCols();
+    assert((int) input.size() == config.imageRows*config.imageCols);
+    assert((int) expected.size() == OUT);
+
+    out << "// C simulation testbench for " << config.name << ", generated by swlb::emitHlsTestbench." << endl;
+    out << "// The expected outputs come from the software line buffer." << endl;
+    out << endl;
+    out << "#include <cstdio>" << endl;
+    out << endl;
+    emitHlsPrototype(out, config);
+    out << ";" << endl;
+    out << endl;
+    emitHlsArray(out, config.elemType, "input", input, config.imageCols);
+    out << endl;
+    emitHlsArray(out, config.elemType, "expected", expected, config.outCols());
+    out << endl;
+
+    out << "int main() {" << endl;
+    out << "  static " << config.elemType << " out[" << OUT << "];" << endl;
+    out << "  int errors = 0;" << endl;
+    out << endl;
+    out << "  for (int frame = 0; frame < 2; frame++) {" << endl;
+    out << "    " << config.name << "(input, out);" << endl;
+    out << "    for (int i = 0; i < " << OUT << "; i++) {" << endl;
+    out << "      if (out[i] != expected[i]) {" << endl;
+    out << "        printf(\"frame %d output %d: got %d, expected %d\\n\", frame, i, (int) out[i], (int) expected[i]);" << endl;
+    out << "        errors++;" << endl;
+    out << "      }" << endl;
+    out << "    }" << endl;
+    out << "  }" << endl;
+    out << endl;
+    out << "  printf(errors == 0 ? \"PASS\\n\" : \"FAIL\\n\");" << endl;
+    out << "  return errors == 0 ? 0 : 1;" << endl;
+    out << "}" << endl;
+  }
+
+  // The testbench for input, with the expected outputs computed by
+  // lineBufferConv.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  void emitHlsTestbench(ostream& out,
+                        const HlsConvConfig& config,
+                        const Mem2D<ElemType, NumImageRows, NumImageCols>& image,
+                        const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) {
+    const int OUT = (NumImageRows - 2*(NumKernelRows / 2))*(NumImageCols - 2*(NumKernelCols / 2));
+
+    CircularFIFO<ElemType, NumImageRows*NumImageCols> in;
+    vector<int> input;
+    for (int i = 0; i < NumImageRows; i++) {
+      for (int j = 0; j < NumImageCols; j++) {
+        in.write(image(i, j));
+        input.push_back(image(i, j));
+      }
+    }
+
+    CircularFIFO<ElemType, OUT> conv;
+    lineBufferConv<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(in, kernel, conv);
+
+    vector<int> expected;
+    while (!conv.isEmpty()) {
+      expected.push_back(conv.read());
+      conv.pop();
+    }
+
+    emitHlsTestbench(out, config, input, expected);
+  }
+
+}
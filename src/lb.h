@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <cassert>
+#include <type_traits>
 
 using namespace std;
 
@@ -27,7 +28,7 @@ namespace swlb {
 
     Mem2D() {
       for (int i = 0; i < NumRows; i++) {
-        for (int j = 0; j < NumRows; j++) {
+        for (int j = 0; j < NumCols; j++) {
           set(i, j, 0);
         }
       }
@@ -115,11 +116,11 @@ namespace swlb {
     PixelLoc(const int r, const int c) : row(r), col(c) {}
   };
 
-  bool operator==(const PixelLoc a, const PixelLoc b) {
+  inline bool operator==(const PixelLoc a, const PixelLoc b) {
     return (a.row == b.row) && (a.col == b.col);
   }
 
-  std::ostream& operator<<(std::ostream& out, const PixelLoc b) {
+  inline std::ostream& operator<<(std::ostream& out, const PixelLoc b) {
     out << "(" << b.row << ", " << b.col << ")";
     return out;
   }
@@ -132,10 +133,11 @@ namespace swlb {
     int ramWidth;
   };
 
-  RAMAddr increment(const RAMAddr addr) {
+  inline RAMAddr increment(const RAMAddr addr) {
     RAMAddr inc;
     inc.numRAMs = addr.numRAMs;
     inc.ramWidth = addr.ramWidth;
+    inc.ramNumber = addr.ramNumber;
     
     int nextInd = addr.indexInRAM + 1;
     if (nextInd == addr.ramWidth) {
@@ -185,13 +187,24 @@ namespace swlb {
   public:
 
     ImageBuffer3x3() {
+      reset();
+    }
+
+    // Starts a new frame in O(1). The line contents are left alone since
+    // every entry is rewritten before a window can read it again, only the
+    // nine window registers are cleared.
+    void reset() {
       writeInd = 0;
       readInd = 0;
 
       readTopLeft = {0, 0};
       writeTopLeft = {0, 0};
-      
+
       empty = true;
+
+      e00 = 0; e01 = 0; e02 = 0;
+      e10 = 0; e11 = 0; e12 = 0;
+      e20 = 0; e21 = 0; e22 = 0;
     }
 
     void printRegisterWindow() {
@@ -213,9 +226,6 @@ namespace swlb {
       e20 = e21;
       e21 = e22;
       e22 = readBuf((readInd + 2*NumImageCols) % LB_SIZE);
-
-      cout << "--------- Register window" << endl;
-      printRegisterWindow();
     }
     
     ElemType readBuf(const int i) {
@@ -260,7 +270,7 @@ namespace swlb {
       int nextCol = writeTopLeft.col + 1;
       if (nextCol == NumImageCols) {
         nextCol = 0;
-        nextRow = nextRow + 1;
+        nextRow = nextRow + 1 == NumImageRows ? 0 : nextRow + 1;
       }
 
       writeTopLeft = {nextRow, nextCol};
@@ -277,7 +287,6 @@ namespace swlb {
 
     int numValidEntries() const {
       if (empty) {
-        cout << "Empty" << endl;
         return 0;
       }
 
@@ -305,9 +314,6 @@ namespace swlb {
     bool windowAlmostFull() const {
       int nValid = numValidEntries();      
       bool almostFull= ((nValid + 2) >= ((WindowRows - 1)*NumImageCols + WindowCols));
-
-      cout << "nValid      = " << nValid << endl;
-      cout << "almost full = " << almostFull << endl;
       return almostFull;
     }
     
@@ -340,7 +346,7 @@ namespace swlb {
       int nextCol = readTopLeft.col + 1;
       if (nextCol == NumImageCols) {
         nextCol = 0;
-        nextRow = nextRow + 1;
+        nextRow = nextRow + 1 == NumImageRows ? 0 : nextRow + 1;
       }
       readTopLeft = {nextRow, nextCol};
 
@@ -452,12 +458,23 @@ namespace swlb {
   public:
 
     ImageBuffer() {
+      reset();
+    }
+
+    // Starts a new frame in O(1). The buffer contents are left alone since
+    // every entry is rewritten before a window can read it again.
+    //
+    // Without a reset, both trackers wrap back to row 0 at the bottom of
+    // the image, so back to back frames can also stream straight through:
+    // windows that straddle two frames fall outside the output bounds and
+    // are never valid.
+    void reset() {
       writeInd = 0;
       readInd = 0;
 
       readTopLeft = {0, 0};
       writeTopLeft = {0, 0};
-      
+
       empty = true;
     }
 
@@ -475,7 +492,7 @@ namespace swlb {
       int nextCol = writeTopLeft.col + 1;
       if (nextCol == NumImageCols) {
         nextCol = 0;
-        nextRow = nextRow + 1;
+        nextRow = nextRow + 1 == NumImageRows ? 0 : nextRow + 1;
       }
 
       writeTopLeft = {nextRow, nextCol};
@@ -534,11 +551,11 @@ namespace swlb {
       int nextCol = readTopLeft.col + 1;
       if (nextCol == NumImageCols) {
         nextCol = 0;
-        nextRow = nextRow + 1;
+        nextRow = nextRow + 1 == NumImageRows ? 0 : nextRow + 1;
       }
       readTopLeft = {nextRow, nextCol};
 
-      if (readInd == readInd) {
+      if (readInd == writeInd) {
         empty = true;
       }
     }
@@ -592,8 +609,11 @@ namespace swlb {
                 const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
                 Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2) >& output) {
 
-    for (int i = 1; i < NumImageRows - 1; i++) {
-      for (int j = 1; j < NumImageCols - 1; j++) {
+    const int ROW_MARGIN = NumKernelRows / 2;
+    const int COL_MARGIN = NumKernelCols / 2;
+
+    for (int i = ROW_MARGIN; i < NumImageRows - ROW_MARGIN; i++) {
+      for (int j = COL_MARGIN; j < NumImageCols - COL_MARGIN; j++) {
 
         int res = 0;
         for (int r = 0; r < NumKernelRows; r++) {
@@ -602,7 +622,7 @@ namespace swlb {
           }
         }
 
-        output.set(i - 1, j - 1, res);
+        output.set(i - ROW_MARGIN, j - COL_MARGIN, res);
 
       }
     }
@@ -636,8 +656,6 @@ namespace swlb {
     
     assert(lb.nextReadCenter() == PixelLoc(1, 1));
 
-    //cout << "Register window on first valid" << endl;
-    lb.printRegisterWindow();
 
     while (true) {
 
@@ -667,10 +685,13 @@ namespace swlb {
     }
   }
   
-  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
-  void lineBufferConv(CircularFIFO<ElemType, NumImageRows*NumImageCols>& input,
-                      const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
-                      CircularFIFO<ElemType, (NumImageRows - 2*((NumKernelRows)/2))*(NumImageCols - 2*((NumKernelCols)/2)) >& lbOutput) {
+  // Convolves a row major pixel stream. Source needs read(), pop() and
+  // isEmpty() like CircularFIFO, and Sink needs write(), so pixels can come
+  // from and go to files or devices as well as FIFOs.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvStream(Source& input,
+                            const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                            Sink& lbOutput) {
 
     ImageBuffer<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols> lb;
     
@@ -703,5 +724,287 @@ namespace swlb {
     }
   }
 
+  // The window a stencil sees: the ImageBuffer's current window, read with
+  // centered offsets like ImageBuffer::read or from the top left corner
+  // with at().
+  template<typename ElemType, int WindowRows, int WindowCols, int NumImageRows, int NumImageCols>
+  class StencilWindow {
+
+    ImageBuffer<ElemType, WindowRows, WindowCols, NumImageRows, NumImageCols>& lb;
+
+  public:
+
+    const static int ROWS = WindowRows;
+    const static int COLS = WindowCols;
+
+    StencilWindow(ImageBuffer<ElemType, WindowRows, WindowCols, NumImageRows, NumImageCols>& lb_) : lb(lb_) {}
+
+    ElemType operator()(const int rowOffset, const int colOffset) const {
+      return lb.read(rowOffset, colOffset);
+    }
+
+    ElemType at(const int row, const int col) const {
+      return lb.read(row - (WindowRows / 2), col - (WindowCols / 2));
+    }
+
+    // Where the window is centered in the image.
+    PixelLoc center() const {
+      return lb.nextReadCenter();
+    }
+  };
+
+  // Runs an arbitrary window operator over a row major pixel stream: f is
+  // called with a StencilWindow for every valid window, in output order,
+  // and its result is written to output. Source and Sink are as for
+  // lineBufferConvStream. f is taken by value and called directly, so a
+  // functor or lambda inlines into the loop like a hand written engine.
+  template<typename ElemType, int WindowRows, int WindowCols, int NumImageRows, int NumImageCols, typename Source, typename Sink, typename F>
+  void lineBufferStencil(Source& input, Sink& output, F f) {
+
+    ImageBuffer<ElemType, WindowRows, WindowCols, NumImageRows, NumImageCols> lb;
+    const StencilWindow<ElemType, WindowRows, WindowCols, NumImageRows, NumImageCols> window(lb);
+
+    while (!lb.windowValid()) {
+      lb.write(input.read());
+      input.pop();
+    }
+
+    while (true) {
+
+      if (lb.windowValid()) {
+        output.write(f(window));
+      }
+
+      if (input.isEmpty()) {
+        break;
+      }
+
+      lb.pop();
+      lb.write(input.read());
+
+      input.pop();
+    }
+  }
+
+  // Convolves a stream of back to back frames through one persistent line
+  // buffer. The first rows of each frame are written while the buffer
+  // still holds the last rows of the one before, so the input never stalls
+  // at a frame boundary and nothing is reallocated or re-primed.
+  //
+  // Source needs read(), pop() and isEmpty() plus endOfFrame(), true when
+  // the pixel at read() is the last of its frame. A frame also ends after
+  // NumImageRows*NumImageCols pixels, so the flag only matters when a
+  // frame is cut short: the buffer is then reset and the next frame starts
+  // cleanly. Sink needs write() and endFrame(), which follows the last
+  // output pixel of each frame.
+  //
+  // run() consumes the source until it is empty and can be called again
+  // with more of the stream later, e.g. one plane of a video frame at a
+  // time.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  class FrameStreamConv {
+
+    const static int FRAME_PIXELS = NumImageRows*NumImageCols;
+
+    Mem2D<ElemType, NumKernelRows, NumKernelCols> kernel;
+    ImageBuffer<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols> lb;
+
+    int framePixels;
+    long framesDone;
+
+  public:
+
+    FrameStreamConv(const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel_) :
+      kernel(kernel_), framePixels(0), framesDone(0) {}
+
+    long frames() const { return framesDone; }
+
+    void reset() {
+      lb.reset();
+      framePixels = 0;
+    }
+
+    template<typename Source, typename Sink>
+    void run(Source& input, Sink& output) {
+      while (!input.isEmpty()) {
+        bool endOfFrame = input.endOfFrame();
+
+        if (lb.windowFull()) {
+          lb.pop();
+        }
+        lb.write(input.read());
+        input.pop();
+        framePixels++;
+
+        if (lb.windowValid()) {
+          int res = 0;
+          for (int row = 0; row < NumKernelRows; row++) {
+            for (int col = 0; col < NumKernelCols; col++) {
+              res += kernel(row, col)*lb.read(row - (NumKernelRows / 2), col - (NumKernelCols / 2));
+            }
+          }
+
+          output.write(res);
+        }
+
+        if (framePixels == FRAME_PIXELS || endOfFrame) {
+          if (framePixels < FRAME_PIXELS) {
+            lb.reset();
+          }
+          framePixels = 0;
+          framesDone++;
+          output.endFrame();
+        }
+      }
+    }
+  };
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  long lineBufferConvFrames(Source& input,
+                            const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                            Sink& output) {
+    FrameStreamConv<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols> conv(kernel);
+    conv.run(input, output);
+    return conv.frames();
+  }
+
+  class SparseTap {
+  public:
+    int row;
+    int col;
+    int coeff;
+  };
+
+  // The non-zero taps of a kernel, in row major order, so a sparse kernel
+  // (a cross, a ring, a pruned learned filter) costs one read and one
+  // multiply per non-zero tap instead of per tap.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols>
+  class SparseKernel {
+
+    SparseTap taps[NumKernelRows*NumKernelCols];
+    int numTaps;
+
+  public:
+
+    SparseKernel(const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) : numTaps(0) {
+      for (int row = 0; row < NumKernelRows; row++) {
+        for (int col = 0; col < NumKernelCols; col++) {
+          if (kernel(row, col) != 0) {
+            taps[numTaps] = {row, col, (int) kernel(row, col)};
+            numTaps++;
+          }
+        }
+      }
+    }
+
+    int size() const {
+      return numTaps;
+    }
+
+    const SparseTap& operator[](const int i) const {
+      return taps[i];
+    }
+  };
+
+  // A lineBufferStencil functor over the taps of a SparseKernel. With
+  // NumTaps > 0 the kernel has exactly that many taps and the loop has a
+  // constant trip count, so it unrolls; NumTaps == 0 loops over however
+  // many there are.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumTaps>
+  class SparseConv {
+
+    const SparseKernel<ElemType, NumKernelRows, NumKernelCols>& taps;
+
+  public:
+
+    SparseConv(const SparseKernel<ElemType, NumKernelRows, NumKernelCols>& taps_) : taps(taps_) {
+      assert(NumTaps == 0 || taps.size() == NumTaps);
+    }
+
+    template<typename Window>
+    int operator()(const Window& w) const {
+      const int n = NumTaps > 0 ? NumTaps : taps.size();
+
+      int res = 0;
+      for (int i = 0; i < n; i++) {
+        res += taps[i].coeff*w.at(taps[i].row, taps[i].col);
+      }
+      return res;
+    }
+  };
+
+  const int MAX_UNROLLED_SPARSE_TAPS = 8;
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, int NumTaps, int MaxUnrolledTaps, typename Source, typename Sink>
+  typename std::enable_if<(NumTaps > MaxUnrolledTaps)>::type
+  lineBufferConvSparseUnrolled(Source& input,
+                               const SparseKernel<ElemType, NumKernelRows, NumKernelCols>& taps,
+                               Sink& lbOutput) {
+    lineBufferStencil<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>
+      (input, lbOutput, SparseConv<ElemType, NumKernelRows, NumKernelCols, 0>(taps));
+  }
+
+  // Picks the instantiation unrolled for taps.size() taps, counting up
+  // from NumTaps, or the general loop past MaxUnrolledTaps.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, int NumTaps, int MaxUnrolledTaps, typename Source, typename Sink>
+  typename std::enable_if<(NumTaps <= MaxUnrolledTaps)>::type
+  lineBufferConvSparseUnrolled(Source& input,
+                               const SparseKernel<ElemType, NumKernelRows, NumKernelCols>& taps,
+                               Sink& lbOutput) {
+    if (taps.size() == NumTaps) {
+      lineBufferStencil<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>
+        (input, lbOutput, SparseConv<ElemType, NumKernelRows, NumKernelCols, NumTaps>(taps));
+      return;
+    }
+
+    lineBufferConvSparseUnrolled<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols, NumTaps + 1, MaxUnrolledTaps>
+      (input, taps, lbOutput);
+  }
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, int MaxUnrolledTaps, typename Source, typename Sink>
+  void lineBufferConvSparseUpTo(Source& input,
+                                const SparseKernel<ElemType, NumKernelRows, NumKernelCols>& taps,
+                                Sink& lbOutput) {
+    if (taps.size() == 0) {
+      lineBufferStencil<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>
+        (input, lbOutput, SparseConv<ElemType, NumKernelRows, NumKernelCols, 0>(taps));
+      return;
+    }
+
+    lineBufferConvSparseUnrolled<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols, 1, MaxUnrolledTaps>(input, taps, lbOutput);
+  }
+
+  // lineBufferConvStream over only the non-zero taps of the kernel: the
+  // cost per pixel is proportional to taps.size(). Kernels of up to
+  // MAX_UNROLLED_SPARSE_TAPS taps run fully unrolled.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvSparse(Source& input,
+                            const SparseKernel<ElemType, NumKernelRows, NumKernelCols>& taps,
+                            Sink& lbOutput) {
+    lineBufferConvSparseUpTo<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols, MAX_UNROLLED_SPARSE_TAPS>(input, taps, lbOutput);
+  }
+
+  // Kernels with at least half their taps zero go through
+  // lineBufferConvSparse; the tap list is built once per call. Denser
+  // kernels gain little or nothing from skipping the odd zero, so they
+  // stay on lineBufferConvStream, and only tap counts that can reach the
+  // sparse path get an unrolled instantiation.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  void lineBufferConv(CircularFIFO<ElemType, NumImageRows*NumImageCols>& input,
+                      const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                      CircularFIFO<ElemType, (NumImageRows - 2*((NumKernelRows)/2))*(NumImageCols - 2*((NumKernelCols)/2)) >& lbOutput) {
+    const int MAX_SPARSE_TAPS = NumKernelRows*NumKernelCols / 2;
+
+    const SparseKernel<ElemType, NumKernelRows, NumKernelCols> taps(kernel);
+    if (taps.size() <= MAX_SPARSE_TAPS) {
+      lineBufferConvSparseUpTo<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols,
+                               (MAX_SPARSE_TAPS < MAX_UNROLLED_SPARSE_TAPS ? MAX_SPARSE_TAPS : MAX_UNROLLED_SPARSE_TAPS)>
+        (input, taps, lbOutput);
+      return;
+    }
+
+    lineBufferConvStream<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(input, kernel, lbOutput);
+  }
+
   
 }
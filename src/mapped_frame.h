@@ -0,0 +1,205 @@
+#pragma once
+
+#include "lb.h"
+
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace swlb {
+
+  // How far ahead of the read position pages are requested, and how often
+  // pages behind it are released. Large enough that the kernel can issue
+  // big reads, small enough that a frame never has to be resident at once.
+  const long MAPPED_ADVICE_WINDOW_BYTES = 4L << 20;
+
+  // A read only mapping of a whole file of raw frames.
+  class MappedFile {
+
+    int fd;
+    const unsigned char* base;
+    long numBytes;
+
+  public:
+
+    MappedFile(const string& path) : fd(-1), base(nullptr), numBytes(0) {
+      fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) {
+        return;
+      }
+
+      struct stat st;
+      if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        return;
+      }
+
+      void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (m == MAP_FAILED) {
+        return;
+      }
+
+      base = (const unsigned char*) m;
+      numBytes = st.st_size;
+      madvise(m, numBytes, MADV_SEQUENTIAL);
+    }
+
+    ~MappedFile() {
+      if (base != nullptr) {
+        munmap((void*) base, numBytes);
+      }
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isValid() const { return base != nullptr; }
+
+    const unsigned char* data() const { return base; }
+    long size() const { return numBytes; }
+
+    static long pageBytes() {
+      static const long bytes = sysconf(_SC_PAGESIZE);
+      return bytes;
+    }
+
+    // Asks the kernel to start reading [offset, offset + bytes) in.
+    void willNeed(const long offset, const long bytes) const {
+      long start = offset - offset % pageBytes();
+      long end = offset + bytes < numBytes ? offset + bytes : numBytes;
+      if (end > start) {
+        madvise((void*) (base + start), end - start, MADV_WILLNEED);
+      }
+    }
+
+    // Drops the whole pages in [offset, offset + bytes) from this mapping
+    // and from the page cache, so reading a file far larger than memory
+    // does not evict everything else.
+    void dontNeed(const long offset, const long bytes) const {
+      long start = offset + (pageBytes() - offset % pageBytes()) % pageBytes();
+      long end = offset + bytes;
+      end -= end % pageBytes();
+      if (end > start) {
+        madvise((void*) (base + start), end - start, MADV_DONTNEED);
+        posix_fadvise(fd, start, end - start, POSIX_FADV_DONTNEED);
+      }
+    }
+  };
+
+  // A zero copy, Mem2D-like view of one frame in a file of back to back
+  // row major raw frames, optionally after a fixed size header.
+  template<typename ElemType, int NumRows, int NumCols>
+  class MappedFrame {
+
+    const MappedFile& file;
+    long offset;
+
+  public:
+
+    const static long FRAME_BYTES = (long) NumRows*NumCols*sizeof(ElemType);
+
+    MappedFrame(const MappedFile& file_, const long frameIndex, const long headerBytes = 0) :
+      file(file_), offset(headerBytes + frameIndex*FRAME_BYTES) {
+      assert(offset % sizeof(ElemType) == 0);
+    }
+
+    static long numFrames(const MappedFile& file, const long headerBytes = 0) {
+      return file.size() < headerBytes ? 0 : (file.size() - headerBytes) / FRAME_BYTES;
+    }
+
+    bool isValid() const {
+      return file.isValid() && offset + FRAME_BYTES <= file.size();
+    }
+
+    const MappedFile& mapping() const { return file; }
+    long byteOffset() const { return offset; }
+
+    const ElemType* data() const {
+      return (const ElemType*) (file.data() + offset);
+    }
+
+    int size() const {
+      return NumRows*NumCols;
+    }
+
+    ElemType operator()(const int r, const int c) const {
+      return data()[r*NumCols + c];
+    }
+  };
+
+  // Streams a mapped frame into a line buffer engine in place of a
+  // CircularFIFO. Pixels are read straight from the mapping. Every
+  // MAPPED_ADVICE_WINDOW_BYTES the next window is prefetched and the pages
+  // already consumed are released, so at most about two windows of the
+  // frame are resident at a time.
+  template<typename ElemType, int NumRows, int NumCols>
+  class MappedFrameSource {
+
+    const MappedFile& file;
+    const ElemType* pixels;
+    long frameOffset;
+    long index;
+
+    long nextAdvice;
+    long released;
+
+    void advise() {
+      long pos = frameOffset + index*(long) sizeof(ElemType);
+      file.dontNeed(released, pos - released);
+      released = pos - pos % MappedFile::pageBytes();
+      file.willNeed(pos + MAPPED_ADVICE_WINDOW_BYTES, MAPPED_ADVICE_WINDOW_BYTES);
+      nextAdvice = index + MAPPED_ADVICE_WINDOW_BYTES / sizeof(ElemType);
+    }
+
+  public:
+
+    MappedFrameSource(const MappedFrame<ElemType, NumRows, NumCols>& frame) :
+      file(frame.mapping()), pixels(frame.data()), frameOffset(frame.byteOffset()), index(0) {
+      assert(frame.isValid());
+
+      released = frameOffset - frameOffset % MappedFile::pageBytes();
+      file.willNeed(frameOffset, 2*MAPPED_ADVICE_WINDOW_BYTES);
+      nextAdvice = MAPPED_ADVICE_WINDOW_BYTES / sizeof(ElemType);
+    }
+
+    ElemType read() const {
+      return pixels[index];
+    }
+
+    void pop() {
+      index++;
+      if (index == nextAdvice) {
+        advise();
+      }
+    }
+
+    bool isEmpty() const {
+      return index == (long) NumRows*NumCols;
+    }
+
+    // Releases whatever is left of the frame once it has been consumed.
+    void releaseAll() {
+      long end = frameOffset + index*(long) sizeof(ElemType);
+      file.dontNeed(released, end - released);
+      released = end;
+    }
+  };
+
+  // lineBufferConv reading the input frame directly from a file mapping.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Sink>
+  void lineBufferConvMapped(const MappedFrame<ElemType, NumImageRows, NumImageCols>& input,
+                            const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                            Sink& lbOutput) {
+    MappedFrameSource<ElemType, NumImageRows, NumImageCols> source(input);
+    lineBufferConvStream<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(source, kernel, lbOutput);
+    source.releaseAll();
+  }
+
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include "lb.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  // The two morphological operators: erosion takes the minimum over the
+  // structuring element, dilation the maximum. The identity is what the
+  // image is padded with, so windows that hang over the border only see
+  // the image samples they cover.
+  template<typename ElemType>
+  class MorphMin {
+  public:
+    static ElemType identity() {
+      return numeric_limits<ElemType>::max();
+    }
+
+    static ElemType apply(const ElemType a, const ElemType b) {
+      return min(a, b);
+    }
+  };
+
+  template<typename ElemType>
+  class MorphMax {
+  public:
+    static ElemType identity() {
+      return numeric_limits<ElemType>::lowest();
+    }
+
+    static ElemType apply(const ElemType a, const ElemType b) {
+      return max(a, b);
+    }
+  };
+
+  // acc = op(acc, row) column by column over a whole row. Each column
+  // is one min or max with no carry between columns, so the loop maps
+  // onto packed min/max instructions a vector at a time.
+  template<typename Op, typename ElemType>
+  void accumulateRow(ElemType* __restrict__ acc, const ElemType* __restrict__ row, const int n) {
+    for (int j = 0; j < n; j++) {
+      acc[j] = Op::apply(acc[j], row[j]);
+    }
+  }
+
+  template<typename Op, typename ElemType>
+  void combineRows(ElemType* __restrict__ out,
+                   const ElemType* __restrict__ a,
+                   const ElemType* __restrict__ b,
+                   const int n) {
+    for (int j = 0; j < n; j++) {
+      out[j] = Op::apply(a[j], b[j]);
+    }
+  }
+
+  // Erosion or dilation by a NumKernelRows x NumKernelCols rectangle, one
+  // row at a time, at a cost per pixel independent of the rectangle.
+  //
+  // Both passes use the van Herk / Gil-Werman decomposition: split the
+  // sequence into blocks of the window length, keep running prefixes
+  // forward and suffixes backward within each block, and every window
+  // straddles at most one block boundary, so its result is
+  // op(suffix at its start, prefix at its end).
+  //
+  // Vertically the sequence is the stream of rows. The rows of the block
+  // being filled are kept, with their running prefix, and turned into
+  // suffixes in place once the block is complete, so the line buffer here
+  // holds 2*NumKernelRows rows instead of NumKernelRows - 1. All of the
+  // vertical work is whole rows combined element by element.
+  // Horizontally the same is done within each row the vertical pass
+  // produces.
+  //
+  // Rows are padded with Op::identity() on every side, so the output is
+  // the size of the input and border windows are clipped to the image.
+  // Each output row is handed to a RowSink, called as sink(const ElemType*
+  // row) with NumImageCols samples, as soon as the input row that
+  // completes its window has been pushed.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageCols, typename Op>
+  class MorphologyRows {
+
+    static_assert(NumKernelRows % 2 == 1 && NumKernelCols % 2 == 1, "structuring elements must have a center");
+
+    const static int ROW_MARGIN = NumKernelRows / 2;
+    const static int COL_MARGIN = NumKernelCols / 2;
+    const static int PADDED_COLS =
+      ((NumImageCols + 2*COL_MARGIN + NumKernelCols - 1) / NumKernelCols)*NumKernelCols;
+
+    vector<ElemType> block;
+    vector<ElemType> suffix;
+    vector<ElemType> prefix;
+    vector<ElemType> identityRow;
+
+    vector<ElemType> line;
+    vector<ElemType> forward;
+    vector<ElemType> backward;
+    vector<ElemType> out;
+
+    long paddedRow;
+
+    void horizontal() {
+      for (int b = 0; b < PADDED_COLS; b += NumKernelCols) {
+        forward[b] = line[b];
+        for (int i = 1; i < NumKernelCols; i++) {
+          forward[b + i] = Op::apply(forward[b + i - 1], line[b + i]);
+        }
+
+        backward[b + NumKernelCols - 1] = line[b + NumKernelCols - 1];
+        for (int i = NumKernelCols - 2; i >= 0; i--) {
+          backward[b + i] = Op::apply(backward[b + i + 1], line[b + i]);
+        }
+      }
+
+      for (int j = 0; j < NumImageCols; j++) {
+        out[j] = Op::apply(backward[j], forward[j + NumKernelCols - 1]);
+      }
+    }
+
+    template<typename RowSink>
+    void pushPadded(const ElemType* row, RowSink& sink) {
+      const int t = paddedRow % NumKernelRows;
+      ElemType* stored = &block[t*NumImageCols];
+
+      copy(row, row + NumImageCols, stored);
+      if (t == 0) {
+        copy(row, row + NumImageCols, prefix.begin());
+      } else {
+        accumulateRow<Op>(&prefix[0], row, NumImageCols);
+      }
+
+      if (paddedRow >= NumKernelRows - 1) {
+        ElemType* vertical = &line[COL_MARGIN];
+        if (t == NumKernelRows - 1) {
+          copy(prefix.begin(), prefix.end(), vertical);
+        } else {
+          combineRows<Op>(vertical, &suffix[(t + 1)*NumImageCols], &prefix[0], NumImageCols);
+        }
+
+        horizontal();
+        sink(static_cast<const ElemType*>(&out[0]));
+      }
+
+      if (t == NumKernelRows - 1) {
+        for (int i = NumKernelRows - 2; i >= 0; i--) {
+          accumulateRow<Op>(&block[i*NumImageCols], &block[(i + 1)*NumImageCols], NumImageCols);
+        }
+        block.swap(suffix);
+      }
+
+      paddedRow++;
+    }
+
+  public:
+
+    MorphologyRows() :
+      block(NumKernelRows*NumImageCols),
+      suffix(NumKernelRows*NumImageCols),
+      prefix(NumImageCols),
+      identityRow(NumImageCols, Op::identity()),
+      line(PADDED_COLS, Op::identity()),
+      forward(PADDED_COLS),
+      backward(PADDED_COLS),
+      out(NumImageCols),
+      paddedRow(0) {}
+
+    template<typename RowSink>
+    void pushRow(const ElemType* row, RowSink& sink) {
+      if (paddedRow == 0) {
+        for (int i = 0; i < ROW_MARGIN; i++) {
+          pushPadded(&identityRow[0], sink);
+        }
+      }
+      pushPadded(row, sink);
+    }
+
+    // Emits the last ROW_MARGIN rows of the image and gets ready for the
+    // next one.
+    template<typename RowSink>
+    void finish(RowSink& sink) {
+      for (int i = 0; i < ROW_MARGIN; i++) {
+        pushPadded(&identityRow[0], sink);
+      }
+      paddedRow = 0;
+    }
+  };
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename First, typename Second, typename Source, typename Sink>
+  void lineBufferMorphologyPair(Source& input, Sink& output) {
+    unique_ptr<MorphologyRows<ElemType, NumKernelRows, NumKernelCols, NumImageCols, First> >
+      first(new MorphologyRows<ElemType, NumKernelRows, NumKernelCols, NumImageCols, First>());
+    unique_ptr<MorphologyRows<ElemType, NumKernelRows, NumKernelCols, NumImageCols, Second> >
+      second(new MorphologyRows<ElemType, NumKernelRows, NumKernelCols, NumImageCols, Second>());
+
+    auto emit = [&output](const ElemType* row) {
+      for (int j = 0; j < NumImageCols; j++) {
+        output.write(row[j]);
+      }
+    };
+    auto chain = [&second, &emit](const ElemType* row) {
+      second->pushRow(row, emit);
+    };
+
+    vector<ElemType> row(NumImageCols);
+    for (int i = 0; i < NumImageRows; i++) {
+      for (int j = 0; j < NumImageCols; j++) {
+        row[j] = input.read();
+        input.pop();
+      }
+      first->pushRow(&row[0], chain);
+    }
+
+    first->finish(chain);
+    second->finish(emit);
+  }
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Op, typename Source, typename Sink>
+  void lineBufferMorphology(Source& input, Sink& output) {
+    unique_ptr<MorphologyRows<ElemType, NumKernelRows, NumKernelCols, NumImageCols, Op> >
+      rows(new MorphologyRows<ElemType, NumKernelRows, NumKernelCols, NumImageCols, Op>());
+
+    auto emit = [&output](const ElemType* row) {
+      for (int j = 0; j < NumImageCols; j++) {
+        output.write(row[j]);
+      }
+    };
+
+    vector<ElemType> row(NumImageCols);
+    for (int i = 0; i < NumImageRows; i++) {
+      for (int j = 0; j < NumImageCols; j++) {
+        row[j] = input.read();
+        input.pop();
+      }
+      rows->pushRow(&row[0], emit);
+    }
+
+    rows->finish(emit);
+  }
+
+  // Morphology engines over a row major pixel stream, with the
+  // lineBufferConvStream source and sink. Unlike the convolution engines
+  // they keep the image size: windows are clipped at the border.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferErode(Source& input, Sink& output) {
+    lineBufferMorphology<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols, MorphMin<ElemType> >(input, output);
+  }
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferDilate(Source& input, Sink& output) {
+    lineBufferMorphology<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols, MorphMax<ElemType> >(input, output);
+  }
+
+  // Opening (erode, then dilate) and closing (dilate, then erode) stream
+  // each row of the first pass straight into the second.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferOpen(Source& input, Sink& output) {
+    lineBufferMorphologyPair<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols,
+                             MorphMin<ElemType>, MorphMax<ElemType> >(input, output);
+  }
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferClose(Source& input, Sink& output) {
+    lineBufferMorphologyPair<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols,
+                             MorphMax<ElemType>, MorphMin<ElemType> >(input, output);
+  }
+
+}
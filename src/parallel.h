@@ -0,0 +1,387 @@
+#pragma once
+
+#include "lb.h"
+#include "cache_planner.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  // A double ended task queue. The owning worker pushes and pops at the
+  // back, idle workers steal from the front.
+  class WorkStealingDeque {
+
+    deque<function<void()> > tasks;
+    mutex m;
+
+  public:
+
+    void push(const function<void()>& task) {
+      unique_lock<mutex> lock(m);
+      tasks.push_back(task);
+    }
+
+    bool pop(function<void()>& task) {
+      unique_lock<mutex> lock(m);
+      if (tasks.empty()) {
+        return false;
+      }
+
+      task = tasks.back();
+      tasks.pop_back();
+      return true;
+    }
+
+    bool steal(function<void()>& task) {
+      unique_lock<mutex> lock(m);
+      if (tasks.empty()) {
+        return false;
+      }
+
+      task = tasks.front();
+      tasks.pop_front();
+      return true;
+    }
+  };
+
+  // Each worker owns a WorkStealingDeque. Submitted tasks are dealt out
+  // round robin and a worker whose deque runs dry steals from the others,
+  // so uneven tasks still keep every core busy.
+  class ThreadPool {
+
+    vector<unique_ptr<WorkStealingDeque> > queues;
+    vector<thread> workers;
+
+    mutex m;
+    condition_variable taskReady;
+    condition_variable allDone;
+
+    int queued;
+    int inFlight;
+    int nextQueue;
+    bool stopping;
+
+    bool findTask(const int self, function<void()>& task) {
+      const int n = queues.size();
+
+      bool found = queues[self]->pop(task);
+      for (int i = 1; !found && i < n; i++) {
+        found = queues[(self + i) % n]->steal(task);
+      }
+
+      if (found) {
+        unique_lock<mutex> lock(m);
+        queued--;
+      }
+
+      return found;
+    }
+
+    void workerLoop(const int self) {
+      while (true) {
+        function<void()> task;
+
+        if (!findTask(self, task)) {
+          unique_lock<mutex> lock(m);
+          taskReady.wait(lock, [this]() { return stopping || queued > 0; });
+
+          if (stopping && queued == 0) {
+            return;
+          }
+
+          continue;
+        }
+
+        task();
+
+        {
+          unique_lock<mutex> lock(m);
+          inFlight--;
+          if (inFlight == 0) {
+            allDone.notify_all();
+          }
+        }
+      }
+    }
+
+  public:
+
+    ThreadPool(const int numThreads) :
+      queued(0), inFlight(0), nextQueue(0), stopping(false) {
+      assert(numThreads > 0);
+
+      for (int i = 0; i < numThreads; i++) {
+        queues.push_back(unique_ptr<WorkStealingDeque>(new WorkStealingDeque()));
+      }
+
+      for (int i = 0; i < numThreads; i++) {
+        workers.push_back(thread([this, i]() { workerLoop(i); }));
+      }
+    }
+
+    ~ThreadPool() {
+      {
+        unique_lock<mutex> lock(m);
+        stopping = true;
+      }
+      taskReady.notify_all();
+
+      for (auto& w : workers) {
+        w.join();
+      }
+    }
+
+    int numThreads() const {
+      return workers.size();
+    }
+
+    void submit(const function<void()>& task) {
+      {
+        unique_lock<mutex> lock(m);
+        queued++;
+        inFlight++;
+        queues[nextQueue]->push(task);
+        nextQueue = (nextQueue + 1) % queues.size();
+      }
+      taskReady.notify_one();
+    }
+
+    void wait() {
+      unique_lock<mutex> lock(m);
+      allDone.wait(lock, [this]() { return inFlight == 0; });
+    }
+  };
+
+  static inline
+  int greatestCommonDivisor(const int a, const int b) {
+    return b == 0 ? a : greatestCommonDivisor(b, a % b);
+  }
+
+  // Strip heights are rounded to a multiple of this many rows so that
+  // every strip boundary falls on a cache line boundary of the output
+  // and no two workers ever write to the same line.
+  template<typename ElemType, int NumOutCols>
+  static inline
+  int stripRowGranularity() {
+    const int CACHE_LINE_BYTES = 64;
+    const int rowBytes = NumOutCols*sizeof(ElemType);
+    return CACHE_LINE_BYTES / greatestCommonDivisor(CACHE_LINE_BYTES, rowBytes);
+  }
+
+  // Computes the NumTileCols wide block of output columns starting at
+  // outColStart for output rows [outRowStart, outRowEnd). The tile and
+  // its halo (NumKernelRows / 2 rows above and below, NumKernelCols / 2
+  // columns left and right) are streamed through a private line buffer
+  // that is only as wide as the tile. Columns past the right edge of the
+  // image are fed as zeros and their outputs dropped.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, int NumTileCols>
+  void lineBufferConvTile(const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                          const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                          Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                          const int outRowStart,
+                          const int outRowEnd,
+                          const int outColStart) {
+
+    const int ROW_MARGIN = NumKernelRows / 2;
+    const int COL_MARGIN = NumKernelCols / 2;
+
+    const int NumOutCols = NumImageCols - 2*COL_MARGIN;
+    const int NumTileInputCols = NumTileCols + 2*COL_MARGIN;
+
+    assert(0 <= outRowStart);
+    assert(outRowStart < outRowEnd);
+    assert(outRowEnd <= NumImageRows - 2*ROW_MARGIN);
+    assert(0 <= outColStart);
+    assert(outColStart < NumOutCols);
+
+    ImageBuffer<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumTileInputCols> lb;
+
+    const int numInputs = ((outRowEnd - outRowStart) + 2*ROW_MARGIN)*NumTileInputCols;
+    int nextInput = 0;
+
+    auto inputPixel = [&input, outRowStart, outColStart](const int i) {
+      int col = outColStart + i % NumTileInputCols;
+      return col < NumImageCols ? input(outRowStart + i / NumTileInputCols, col) : 0;
+    };
+
+    while (!lb.windowValid()) {
+      lb.write(inputPixel(nextInput));
+      nextInput++;
+    }
+
+    while (true) {
+
+      if (lb.windowValid()) {
+        PixelLoc center = lb.nextReadCenter();
+        int outCol = outColStart + center.col - COL_MARGIN;
+
+        if (outCol < NumOutCols) {
+          int res = 0;
+          for (int row = 0; row < NumKernelRows; row++) {
+            for (int col = 0; col < NumKernelCols; col++) {
+              res += kernel(row, col)*lb.read(row - (NumKernelRows / 2), col - (NumKernelCols / 2));
+            }
+          }
+
+          output.set(outRowStart + center.row - ROW_MARGIN, outCol, res);
+        }
+      }
+
+      if (nextInput == numInputs) {
+        break;
+      }
+
+      lb.pop();
+      lb.write(inputPixel(nextInput));
+      nextInput++;
+    }
+  }
+
+  // Computes output rows [outRowStart, outRowEnd) as a single tile that
+  // spans the full width of the image.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  void lineBufferConvStrip(const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                           const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                           Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                           const int outRowStart,
+                           const int outRowEnd) {
+    const int NumOutCols = NumImageCols - 2*(NumKernelCols / 2);
+    lineBufferConvTile<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols, NumOutCols>(input, kernel, output, outRowStart, outRowEnd, 0);
+  }
+
+  const int DEFAULT_TILE_ROWS = 64;
+
+  // Splits the output into a grid of NumTileCols x tileRows tiles and
+  // convolves them on the work stealing pool. Narrow tiles keep each line
+  // buffer cache resident on very wide images. Output is identical to
+  // lineBufferConv.
+  template<int NumTileCols, typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  void lineBufferConvTiled(const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                           const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                           Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                           ThreadPool& pool,
+                           const int tileRows = DEFAULT_TILE_ROWS) {
+
+    const int NumOutRows = NumImageRows - 2*(NumKernelRows / 2);
+    const int NumOutCols = NumImageCols - 2*(NumKernelCols / 2);
+
+    assert(tileRows > 0);
+
+    for (int rowStart = 0; rowStart < NumOutRows; rowStart += tileRows) {
+      int rowEnd = min(rowStart + tileRows, NumOutRows);
+
+      for (int colStart = 0; colStart < NumOutCols; colStart += NumTileCols) {
+        pool.submit([&input, &kernel, &output, rowStart, rowEnd, colStart]() {
+            lineBufferConvTile<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols, NumTileCols>(input, kernel, output, rowStart, rowEnd, colStart);
+          });
+      }
+    }
+
+    pool.wait();
+  }
+
+  // Planned tile widths are instantiated in steps of 4x, from
+  // MIN_PLANNED_TILE_COLS up to MAX_PLANNED_TILE_COLS.
+  const int MIN_PLANNED_TILE_COLS = 16;
+  const int MAX_PLANNED_TILE_COLS = 4096;
+
+  // Runs lineBufferConvTiled with the widest instantiated tile width that
+  // is no wider than tileCols.
+  template<int NumTileCols>
+  class PlannedTileDispatch {
+  public:
+
+    template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+    static void run(const int tileCols,
+                    const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                    const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                    Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                    ThreadPool& pool,
+                    const int tileRows) {
+      if (tileCols < 4*NumTileCols) {
+        lineBufferConvTiled<NumTileCols>(input, kernel, output, pool, tileRows);
+      } else {
+        PlannedTileDispatch<4*NumTileCols>::run(tileCols, input, kernel, output, pool, tileRows);
+      }
+    }
+  };
+
+  template<>
+  class PlannedTileDispatch<MAX_PLANNED_TILE_COLS> {
+  public:
+
+    template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+    static void run(const int,
+                    const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                    const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                    Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                    ThreadPool& pool,
+                    const int tileRows) {
+      lineBufferConvTiled<MAX_PLANNED_TILE_COLS>(input, kernel, output, pool, tileRows);
+    }
+  };
+
+  // Tiled convolution with the tile width chosen by planner, by default so
+  // that each tile's line buffer fits in half of this machine's L2.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  void lineBufferConvTiled(const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                           const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                           Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                           ThreadPool& pool,
+                           const int tileRows = DEFAULT_TILE_ROWS,
+                           const StripPlanner& planner = StripPlanner::host()) {
+    const int NumOutCols = NumImageCols - 2*(NumKernelCols / 2);
+
+    int tileCols = planner.stripCols(sizeof(ElemType), NumKernelRows, NumKernelCols, NumOutCols);
+    if (tileCols >= NumOutCols) {
+      lineBufferConvTiled<NumOutCols>(input, kernel, output, pool, tileRows);
+    } else {
+      PlannedTileDispatch<MIN_PLANNED_TILE_COLS>::run(tileCols, input, kernel, output, pool, tileRows);
+    }
+  }
+
+  // Splits the output into horizontal strips and convolves each one on a
+  // worker of pool. numStrips defaults to the number of workers. When a
+  // full width line buffer does not fit the planner's budget each strip is
+  // further cut into column strips. Output is identical to lineBufferConv.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  void lineBufferConvParallel(const Mem2D<ElemType, NumImageRows, NumImageCols>& input,
+                              const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                              Mem2D<ElemType, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output,
+                              ThreadPool& pool,
+                              const int numStrips = 0,
+                              const StripPlanner& planner = StripPlanner::host()) {
+
+    const int NumOutRows = NumImageRows - 2*(NumKernelRows / 2);
+    const int NumOutCols = NumImageCols - 2*(NumKernelCols / 2);
+
+    int strips = numStrips > 0 ? numStrips : pool.numThreads();
+
+    int granularity = stripRowGranularity<ElemType, NumOutCols>();
+    int stripRows = (NumOutRows + strips - 1) / strips;
+    stripRows = ((stripRows + granularity - 1) / granularity)*granularity;
+
+    if (planner.stripCols(sizeof(ElemType), NumKernelRows, NumKernelCols, NumOutCols) < NumOutCols) {
+      lineBufferConvTiled(input, kernel, output, pool, stripRows, planner);
+      return;
+    }
+
+    for (int start = 0; start < NumOutRows; start += stripRows) {
+      int end = min(start + stripRows, NumOutRows);
+      pool.submit([&input, &kernel, &output, start, end]() {
+          lineBufferConvStrip(input, kernel, output, start, end);
+        });
+    }
+
+    pool.wait();
+  }
+
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include "channels.h"
+#include "lb.h"
+
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  // stdio buffer size for PNM files, so row sized reads and writes turn
+  // into a few large system calls.
+  const int PNM_IO_BUFFER_BYTES = 1 << 20;
+
+  // Streams the rows of a binary PGM (P5) or PPM (P6) file with 8 or 16
+  // bit samples. Only the header is parsed up front, after that rows are
+  // read on demand and the full image is never held in memory.
+  class PnmReader {
+
+    FILE* file;
+    bool valid;
+
+    int numCols;
+    int numRows;
+    int numChannels;
+    int maxValue;
+    int rowsRead;
+
+    vector<unsigned char> rowBytes;
+
+    // Skips whitespace and # comments, then reads a decimal integer.
+    bool readHeaderInt(int& value) {
+      int c = fgetc(file);
+      while (c != EOF && (isspace(c) || c == '#')) {
+        if (c == '#') {
+          while (c != EOF && c != '\n') {
+            c = fgetc(file);
+          }
+        }
+        c = fgetc(file);
+      }
+
+      if (c == EOF || !isdigit(c)) {
+        return false;
+      }
+
+      value = 0;
+      while (c != EOF && isdigit(c)) {
+        value = 10*value + (c - '0');
+        c = fgetc(file);
+      }
+
+      // Exactly one whitespace character separates the header from the
+      // samples, and it has now been consumed.
+      return c != EOF && isspace(c);
+    }
+
+  public:
+
+    PnmReader(const string& path) :
+      valid(false), numCols(0), numRows(0), numChannels(0), maxValue(0), rowsRead(0) {
+
+      file = fopen(path.c_str(), "rb");
+      if (file == nullptr) {
+        return;
+      }
+      setvbuf(file, nullptr, _IOFBF, PNM_IO_BUFFER_BYTES);
+
+      char magic[2];
+      if (fread(magic, 1, 2, file) != 2 || magic[0] != 'P' ||
+          (magic[1] != '5' && magic[1] != '6')) {
+        return;
+      }
+      numChannels = magic[1] == '5' ? 1 : 3;
+
+      if (!readHeaderInt(numCols) || !readHeaderInt(numRows) || !readHeaderInt(maxValue)) {
+        return;
+      }
+
+      if (numCols <= 0 || numRows <= 0 || maxValue <= 0 || maxValue > 65535) {
+        return;
+      }
+
+      rowBytes.resize(rowSamples()*bytesPerSample());
+      valid = true;
+    }
+
+    ~PnmReader() {
+      if (file != nullptr) {
+        fclose(file);
+      }
+    }
+
+    PnmReader(const PnmReader&) = delete;
+    PnmReader& operator=(const PnmReader&) = delete;
+
+    bool isValid() const { return valid; }
+
+    int cols() const { return numCols; }
+    int rows() const { return numRows; }
+    int channels() const { return numChannels; }
+    int maxVal() const { return maxValue; }
+
+    int bytesPerSample() const { return maxValue < 256 ? 1 : 2; }
+    int rowSamples() const { return numCols*numChannels; }
+
+    bool done() const { return rowsRead == numRows; }
+
+    // Reads the next row, cols()*channels() interleaved samples, into row.
+    // 16 bit samples are stored big endian in the file.
+    template<typename ElemType>
+    bool readRow(ElemType* row) {
+      if (!valid || done()) {
+        return false;
+      }
+
+      if (fread(rowBytes.data(), 1, rowBytes.size(), file) != rowBytes.size()) {
+        valid = false;
+        return false;
+      }
+
+      const int n = rowSamples();
+      if (bytesPerSample() == 1) {
+        for (int i = 0; i < n; i++) {
+          row[i] = rowBytes[i];
+        }
+      } else {
+        for (int i = 0; i < n; i++) {
+          row[i] = (rowBytes[2*i] << 8) | rowBytes[2*i + 1];
+        }
+      }
+
+      rowsRead++;
+      return true;
+    }
+  };
+
+  // Writes a binary PGM (P5) or PPM (P6) row by row. Samples are clamped to
+  // [0, maxVal].
+  class PnmWriter {
+
+    FILE* file;
+    bool valid;
+
+    int numCols;
+    int numRows;
+    int numChannels;
+    int maxValue;
+    int rowsWritten;
+
+    vector<unsigned char> rowBytes;
+
+  public:
+
+    PnmWriter(const string& path, const int cols, const int rows, const int channels, const int maxVal) :
+      valid(false), numCols(cols), numRows(rows), numChannels(channels), maxValue(maxVal), rowsWritten(0) {
+
+      assert(channels == 1 || channels == 3);
+      assert(0 < maxVal && maxVal <= 65535);
+
+      file = fopen(path.c_str(), "wb");
+      if (file == nullptr) {
+        return;
+      }
+      setvbuf(file, nullptr, _IOFBF, PNM_IO_BUFFER_BYTES);
+
+      rowBytes.resize(numCols*numChannels*bytesPerSample());
+      valid = fprintf(file, "P%d\n%d %d\n%d\n", channels == 1 ? 5 : 6, cols, rows, maxVal) > 0;
+    }
+
+    ~PnmWriter() {
+      close();
+    }
+
+    PnmWriter(const PnmWriter&) = delete;
+    PnmWriter& operator=(const PnmWriter&) = delete;
+
+    bool isValid() const { return valid; }
+
+    int cols() const { return numCols; }
+    int rows() const { return numRows; }
+    int channels() const { return numChannels; }
+    int bytesPerSample() const { return maxValue < 256 ? 1 : 2; }
+    int rowSamples() const { return numCols*numChannels; }
+
+    bool done() const { return rowsWritten == numRows; }
+
+    template<typename ElemType>
+    bool writeRow(const ElemType* row) {
+      if (!valid || done()) {
+        return false;
+      }
+
+      const int n = rowSamples();
+      for (int i = 0; i < n; i++) {
+        int v = row[i];
+        v = v < 0 ? 0 : (v > maxValue ? maxValue : v);
+        if (bytesPerSample() == 1) {
+          rowBytes[i] = v;
+        } else {
+          rowBytes[2*i] = v >> 8;
+          rowBytes[2*i + 1] = v & 0xff;
+        }
+      }
+
+      if (fwrite(rowBytes.data(), 1, rowBytes.size(), file) != rowBytes.size()) {
+        valid = false;
+        return false;
+      }
+
+      rowsWritten++;
+      return true;
+    }
+
+    // Flushes and closes the file. Returns false if anything failed or
+    // fewer rows than the header promised were written.
+    bool close() {
+      if (file == nullptr) {
+        return false;
+      }
+
+      bool ok = fclose(file) == 0 && valid && done();
+      file = nullptr;
+      return ok;
+    }
+  };
+
+  // Adapts a PnmReader to the read()/pop()/isEmpty() pixel stream the line
+  // buffer engines consume, holding one row at a time.
+  template<typename ElemType>
+  class PnmPixelSource {
+
+    PnmReader& reader;
+    vector<ElemType> row;
+    int index;
+    bool empty;
+
+    void nextRow() {
+      index = 0;
+      empty = !reader.readRow(row.data());
+    }
+
+  public:
+
+    PnmPixelSource(PnmReader& reader_) : reader(reader_), row(reader_.rowSamples()) {
+      nextRow();
+    }
+
+    ElemType read() const {
+      return row[index];
+    }
+
+    void pop() {
+      index++;
+      if (index == (int) row.size()) {
+        nextRow();
+      }
+    }
+
+    bool isEmpty() const {
+      return empty;
+    }
+  };
+
+  // Adapts a PnmWriter to the write() pixel stream the line buffer engines
+  // produce, writing each row out as soon as it is complete. Results are
+  // kept as the engines' int sums so that writeRow clamps the real value
+  // rather than one already wrapped to the element type.
+  class PnmPixelSink {
+
+    PnmWriter& writer;
+    vector<int> row;
+    int index;
+
+  public:
+
+    PnmPixelSink(PnmWriter& writer_) : writer(writer_), row(writer_.rowSamples()), index(0) {}
+
+    void write(const int value) {
+      row[index] = value;
+      index++;
+      if (index == (int) row.size()) {
+        writer.writeRow(row.data());
+        index = 0;
+      }
+    }
+  };
+
+  // Convolves a single channel PNM file into another, streaming rows from
+  // reader through lineBufferConv's engine into writer. The writer must be
+  // sized for the valid output region. Returns false if the files do not
+  // match the compile time geometry or an I/O error occurs.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  bool lineBufferConvPnm(PnmReader& reader,
+                         const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                         PnmWriter& writer) {
+    if (!reader.isValid() || !writer.isValid() ||
+        reader.channels() != 1 || writer.channels() != 1 ||
+        reader.rows() != NumImageRows || reader.cols() != NumImageCols ||
+        writer.rows() != NumImageRows - 2*(NumKernelRows / 2) ||
+        writer.cols() != NumImageCols - 2*(NumKernelCols / 2)) {
+      return false;
+    }
+
+    PnmPixelSource<ElemType> source(reader);
+    PnmPixelSink sink(writer);
+    lineBufferConvStream<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(source, kernel, sink);
+
+    return reader.isValid() && writer.done();
+  }
+
+  // The RGB version for PPM files, with one kernel per channel. The
+  // output stays interleaved.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  bool lineBufferConvPnm(PnmReader& reader,
+                         const ChannelKernels<ElemType, 3, NumKernelRows, NumKernelCols>& kernels,
+                         PnmWriter& writer) {
+    if (!reader.isValid() || !writer.isValid() ||
+        reader.channels() != 3 || writer.channels() != 3 ||
+        reader.rows() != NumImageRows || reader.cols() != NumImageCols ||
+        writer.rows() != NumImageRows - 2*(NumKernelRows / 2) ||
+        writer.cols() != NumImageCols - 2*(NumKernelCols / 2)) {
+      return false;
+    }
+
+    PnmPixelSource<ElemType> source(reader);
+    PnmPixelSink sink(writer);
+    lineBufferConvChannels<ElemType, 3, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(source, kernels, sink);
+
+    return reader.isValid() && writer.done();
+  }
+
+}
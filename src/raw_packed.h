@@ -0,0 +1,164 @@
+#pragma once
+
+#include "lb.h"
+
+#include <cstdint>
+
+using namespace std;
+
+namespace swlb {
+
+  // MIPI CSI-2 packed Bayer formats.
+  //
+  // RAW10 packs 4 pixels into 5 bytes: the 8 high bits of each pixel,
+  // then one byte holding the 2 low bits of pixels 0..3 from the least
+  // significant end.
+  //
+  // RAW12 packs 2 pixels into 3 bytes: the 8 high bits of each pixel,
+  // then one byte holding the 4 low bits of pixel 0 in its low nibble and
+  // of pixel 1 in its high nibble.
+  enum PackedFormat {
+    PACKED_RAW10,
+    PACKED_RAW12
+  };
+
+  constexpr int packedGroupPixels(const PackedFormat f) {
+    return f == PACKED_RAW10 ? 4 : 2;
+  }
+
+  constexpr int packedGroupBytes(const PackedFormat f) {
+    return f == PACKED_RAW10 ? 5 : 3;
+  }
+
+  // Bytes of one packed row, rounded up to whole groups. Sensors often pad
+  // rows further, which is why the readers take a separate stride.
+  constexpr long packedRowBytes(const PackedFormat f, const int cols) {
+    return (long) ((cols + packedGroupPixels(f) - 1) / packedGroupPixels(f))*packedGroupBytes(f);
+  }
+
+  template<typename ElemType>
+  inline void unpackGroup(const PackedFormat f, const uint8_t* bytes, ElemType* pixels) {
+    if (f == PACKED_RAW10) {
+      const int low = bytes[4];
+      pixels[0] = (bytes[0] << 2) | (low & 3);
+      pixels[1] = (bytes[1] << 2) | ((low >> 2) & 3);
+      pixels[2] = (bytes[2] << 2) | ((low >> 4) & 3);
+      pixels[3] = (bytes[3] << 2) | (low >> 6);
+    } else {
+      const int low = bytes[2];
+      pixels[0] = (bytes[0] << 4) | (low & 15);
+      pixels[1] = (bytes[1] << 4) | (low >> 4);
+    }
+  }
+
+  template<typename ElemType>
+  inline void packGroup(const PackedFormat f, const ElemType* pixels, uint8_t* bytes) {
+    if (f == PACKED_RAW10) {
+      bytes[4] = 0;
+      for (int i = 0; i < 4; i++) {
+        bytes[i] = pixels[i] >> 2;
+        bytes[4] |= (pixels[i] & 3) << (2*i);
+      }
+    } else {
+      bytes[0] = pixels[0] >> 4;
+      bytes[1] = pixels[1] >> 4;
+      bytes[2] = (pixels[0] & 15) | ((pixels[1] & 15) << 4);
+    }
+  }
+
+  // Unpacks cols pixels of one packed row.
+  template<typename ElemType>
+  void unpackRow(const PackedFormat f, const uint8_t* bytes, const int cols, ElemType* row) {
+    const int groupPixels = packedGroupPixels(f);
+    const int groupBytes = packedGroupBytes(f);
+
+    int j = 0;
+    for (; j + groupPixels <= cols; j += groupPixels) {
+      unpackGroup(f, bytes + (j / groupPixels)*groupBytes, row + j);
+    }
+
+    if (j < cols) {
+      ElemType tail[4];
+      unpackGroup(f, bytes + (j / groupPixels)*groupBytes, tail);
+      for (int k = 0; j + k < cols; k++) {
+        row[j + k] = tail[k];
+      }
+    }
+  }
+
+  // Packs cols pixels into one row, zero filling a partial last group.
+  template<typename ElemType>
+  void packRow(const PackedFormat f, const ElemType* row, const int cols, uint8_t* bytes) {
+    const int groupPixels = packedGroupPixels(f);
+    const int groupBytes = packedGroupBytes(f);
+
+    for (int j = 0; j < cols; j += groupPixels) {
+      ElemType group[4] = {0, 0, 0, 0};
+      for (int k = 0; k < groupPixels && j + k < cols; k++) {
+        group[k] = row[j + k];
+      }
+      packGroup(f, group, bytes + (j / groupPixels)*groupBytes);
+    }
+  }
+
+  // Streams a packed frame into a line buffer engine, unpacking each row
+  // as the engine reaches it. Only the packed bytes are read from memory;
+  // the one unpacked row stays in L1, so there is no unpacked copy of the
+  // frame for the engine to stream back in.
+  template<typename ElemType, int NumRows, int NumCols>
+  class PackedRawSource {
+
+    const PackedFormat format;
+    const uint8_t* rowStart;
+    const long stride;
+
+    int rowsLeft;
+    int col;
+
+    ElemType row[NumCols];
+
+    void loadRow() {
+      unpackRow(format, rowStart, NumCols, row);
+      rowStart += stride;
+      rowsLeft--;
+      col = 0;
+    }
+
+  public:
+
+    PackedRawSource(const uint8_t* frame, const PackedFormat format_, const long stride_ = 0) :
+      format(format_), rowStart(frame), stride(stride_ > 0 ? stride_ : packedRowBytes(format_, NumCols)),
+      rowsLeft(NumRows) {
+      assert(stride >= packedRowBytes(format, NumCols));
+      loadRow();
+    }
+
+    ElemType read() const {
+      return row[col];
+    }
+
+    void pop() {
+      col++;
+      if (col == NumCols && rowsLeft > 0) {
+        loadRow();
+      }
+    }
+
+    bool isEmpty() const {
+      return col == NumCols;
+    }
+  };
+
+  // lineBufferConv over a packed RAW10/RAW12 frame in memory, e.g. a
+  // capture buffer or a MappedFrame's bytes.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Sink>
+  void lineBufferConvPacked(const uint8_t* frame,
+                            const PackedFormat format,
+                            const long stride,
+                            const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                            Sink& lbOutput) {
+    PackedRawSource<ElemType, NumImageRows, NumImageCols> source(frame, format, stride);
+    lineBufferConvStream<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(source, kernel, lbOutput);
+  }
+
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "lb.h"
+
+using namespace std;
+
+namespace swlb {
+
+  // How one compile time coefficient is applied to a sample. Zero taps
+  // never read the window at all, +-1 become adds and subtracts, and
+  // +-2^k become shifts; anything else is a multiply by a constant.
+  constexpr int tapShift(const int v, const int k = 0) {
+    return v == 1 ? k : tapShift(v / 2, k + 1);
+  }
+
+  constexpr bool tapIsPowerOfTwo(const int v) {
+    return v > 1 && (v & (v - 1)) == 0;
+  }
+
+  enum TapKind {
+    TAP_ZERO,
+    TAP_ADD,
+    TAP_SUBTRACT,
+    TAP_SHIFT_ADD,
+    TAP_SHIFT_SUBTRACT,
+    TAP_MULTIPLY
+  };
+
+  constexpr TapKind tapKind(const int v) {
+    return v == 0 ? TAP_ZERO :
+      v == 1 ? TAP_ADD :
+      v == -1 ? TAP_SUBTRACT :
+      tapIsPowerOfTwo(v) ? TAP_SHIFT_ADD :
+      tapIsPowerOfTwo(-v) ? TAP_SHIFT_SUBTRACT :
+      TAP_MULTIPLY;
+  }
+
+  // The term tap (Row, Col) with coefficient Value contributes. Shifts go
+  // through unsigned so negative samples shift without undefined
+  // behavior.
+  template<int Value, int Row, int Col, TapKind Kind = tapKind(Value)>
+  class StaticTap {
+  public:
+    template<typename Window>
+    static int term(const Window& w) {
+      return Value*w.at(Row, Col);
+    }
+  };
+
+  template<int Value, int Row, int Col>
+  class StaticTap<Value, Row, Col, TAP_ZERO> {
+  public:
+    template<typename Window>
+    static int term(const Window&) {
+      return 0;
+    }
+  };
+
+  template<int Value, int Row, int Col>
+  class StaticTap<Value, Row, Col, TAP_ADD> {
+  public:
+    template<typename Window>
+    static int term(const Window& w) {
+      return w.at(Row, Col);
+    }
+  };
+
+  template<int Value, int Row, int Col>
+  class StaticTap<Value, Row, Col, TAP_SUBTRACT> {
+  public:
+    template<typename Window>
+    static int term(const Window& w) {
+      return -w.at(Row, Col);
+    }
+  };
+
+  template<int Value, int Row, int Col>
+  class StaticTap<Value, Row, Col, TAP_SHIFT_ADD> {
+  public:
+    template<typename Window>
+    static int term(const Window& w) {
+      return (int) ((unsigned) w.at(Row, Col) << tapShift(Value));
+    }
+  };
+
+  template<int Value, int Row, int Col>
+  class StaticTap<Value, Row, Col, TAP_SHIFT_SUBTRACT> {
+  public:
+    template<typename Window>
+    static int term(const Window& w) {
+      return -(int) ((unsigned) w.at(Row, Col) << tapShift(-Value));
+    }
+  };
+
+  // Sums the terms of taps Index onwards, unrolled at compile time.
+  template<int NumKernelCols, int Index, int... Taps>
+  class StaticTaps {
+  public:
+    template<typename Window>
+    static int sum(const Window&) {
+      return 0;
+    }
+  };
+
+  template<int NumKernelCols, int Index, int Tap, int... Rest>
+  class StaticTaps<NumKernelCols, Index, Tap, Rest...> {
+  public:
+    template<typename Window>
+    static int sum(const Window& w) {
+      return StaticTap<Tap, Index / NumKernelCols, Index % NumKernelCols>::term(w) +
+        StaticTaps<NumKernelCols, Index + 1, Rest...>::sum(w);
+    }
+  };
+
+  // A kernel whose coefficients are template arguments, row major:
+  //
+  //   typedef StaticKernel<3, 3, -1, 0, 1, -2, 0, 2, -1, 0, 1> SobelX;
+  //
+  // Applied to a window it expands to one term per non-zero tap, with no
+  // loads of coefficients and none of the zero taps' samples.
+  template<int NumKernelRows, int NumKernelCols, int... Taps>
+  class StaticKernel {
+
+    static_assert(sizeof...(Taps) == NumKernelRows*NumKernelCols, "one coefficient per tap");
+
+  public:
+
+    const static int ROWS = NumKernelRows;
+    const static int COLS = NumKernelCols;
+
+    template<typename Window>
+    int operator()(const Window& w) const {
+      return StaticTaps<NumKernelCols, 0, Taps...>::sum(w);
+    }
+
+    // The same kernel as a runtime Mem2D, for the generic engines.
+    template<typename ElemType>
+    static Mem2D<ElemType, NumKernelRows, NumKernelCols> toMem2D() {
+      const int taps[] = {Taps...};
+      Mem2D<ElemType, NumKernelRows, NumKernelCols> kernel;
+      for (int i = 0; i < NumKernelRows; i++) {
+        for (int j = 0; j < NumKernelCols; j++) {
+          kernel.set(i, j, taps[i*NumKernelCols + j]);
+        }
+      }
+      return kernel;
+    }
+  };
+
+  typedef StaticKernel<3, 3,
+                       -1, 0, 1,
+                       -2, 0, 2,
+                       -1, 0, 1> SobelXKernel;
+
+  typedef StaticKernel<3, 3,
+                       -1, -2, -1,
+                       0, 0, 0,
+                       1, 2, 1> SobelYKernel;
+
+  typedef StaticKernel<3, 3,
+                       0, 1, 0,
+                       1, -4, 1,
+                       0, 1, 0> LaplacianKernel;
+
+  typedef StaticKernel<3, 3,
+                       1, 2, 1,
+                       2, 4, 2,
+                       1, 2, 1> Binomial3Kernel;
+
+  typedef StaticKernel<5, 5,
+                       1, 4, 6, 4, 1,
+                       4, 16, 24, 16, 4,
+                       6, 24, 36, 24, 6,
+                       4, 16, 24, 16, 4,
+                       1, 4, 6, 4, 1> Binomial5Kernel;
+
+  // lineBufferConvStream with a StaticKernel.
+  template<typename Kernel, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvStatic(Source& input, Sink& lbOutput) {
+    lineBufferStencil<int, Kernel::ROWS, Kernel::COLS, NumImageRows, NumImageCols>(input, lbOutput, Kernel());
+  }
+
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "lb.h"
+
+using namespace std;
+
+namespace swlb {
+
+  // Mirror symmetries of a kernel, as flags. Horizontal symmetry means
+  // every row reads the same backwards, k(r, c) == k(r, cols - 1 - c), and
+  // vertical symmetry the same for columns.
+  enum KernelSymmetry {
+    SYMMETRY_NONE = 0,
+    SYMMETRY_HORIZONTAL = 1,
+    SYMMETRY_VERTICAL = 2,
+    SYMMETRY_BOTH = 3
+  };
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols>
+  bool kernelHasSymmetry(const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel, const int symmetry) {
+    for (int r = 0; r < NumKernelRows; r++) {
+      for (int c = 0; c < NumKernelCols; c++) {
+        if ((symmetry & SYMMETRY_HORIZONTAL) && kernel(r, c) != kernel(r, NumKernelCols - 1 - c)) {
+          return false;
+        }
+        if ((symmetry & SYMMETRY_VERTICAL) && kernel(r, c) != kernel(NumKernelRows - 1 - r, c)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  template<typename ElemType, int NumKernelRows, int NumKernelCols>
+  KernelSymmetry kernelSymmetry(const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) {
+    int symmetry = SYMMETRY_NONE;
+    if (kernelHasSymmetry(kernel, SYMMETRY_HORIZONTAL)) {
+      symmetry |= SYMMETRY_HORIZONTAL;
+    }
+    if (kernelHasSymmetry(kernel, SYMMETRY_VERTICAL)) {
+      symmetry |= SYMMETRY_VERTICAL;
+    }
+    return static_cast<KernelSymmetry>(symmetry);
+  }
+
+  // A lineBufferStencil functor convolving with a kernel folded along its
+  // mirror axes. Only the taps of one half (or quarter) are kept, and the
+  // samples under each kept tap and its mirror images are added before the
+  // one multiply: (a + b)*k instead of a*k + b*k. On the axis itself a tap
+  // is its own mirror and is taken once. For integer samples this is
+  // exactly the unfolded sum.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int Symmetry>
+  class FoldedConv {
+
+    const static bool FOLD_COLS = (Symmetry & SYMMETRY_HORIZONTAL) != 0;
+    const static bool FOLD_ROWS = (Symmetry & SYMMETRY_VERTICAL) != 0;
+
+    const static int FOLDED_ROWS = FOLD_ROWS ? (NumKernelRows + 1) / 2 : NumKernelRows;
+    const static int FOLDED_COLS = FOLD_COLS ? (NumKernelCols + 1) / 2 : NumKernelCols;
+
+    int coeffs[FOLDED_ROWS][FOLDED_COLS];
+
+  public:
+
+    FoldedConv(const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) {
+      for (int r = 0; r < FOLDED_ROWS; r++) {
+        for (int c = 0; c < FOLDED_COLS; c++) {
+          coeffs[r][c] = kernel(r, c);
+        }
+      }
+    }
+
+    template<typename Window>
+    int operator()(const Window& w) const {
+      int res = 0;
+      for (int r = 0; r < FOLDED_ROWS; r++) {
+        const int mirrorRow = NumKernelRows - 1 - r;
+        const bool addRow = FOLD_ROWS && mirrorRow != r;
+
+        for (int c = 0; c < FOLDED_COLS; c++) {
+          const int mirrorCol = NumKernelCols - 1 - c;
+          const bool addCol = FOLD_COLS && mirrorCol != c;
+
+          int s = w.at(r, c);
+          if (addCol) {
+            s += w.at(r, mirrorCol);
+          }
+          if (addRow) {
+            s += w.at(mirrorRow, c);
+            if (addCol) {
+              s += w.at(mirrorRow, mirrorCol);
+            }
+          }
+          res += coeffs[r][c]*s;
+        }
+      }
+      return res;
+    }
+  };
+
+  // lineBufferConvStream for a kernel with the given mirror symmetries,
+  // which must hold: each kind of folding is its own instantiation of the
+  // inner loop, so the loop itself has no symmetry tests left in it.
+  // Folding one axis halves the multiplies per output and folding both
+  // quarters them, rounding up for the taps on the axes.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvSymmetric(Source& input,
+                               const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                               Sink& lbOutput,
+                               const KernelSymmetry symmetry) {
+    assert(kernelHasSymmetry(kernel, symmetry));
+
+    switch (symmetry) {
+    case SYMMETRY_HORIZONTAL:
+      lineBufferStencil<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>
+        (input, lbOutput, FoldedConv<ElemType, NumKernelRows, NumKernelCols, SYMMETRY_HORIZONTAL>(kernel));
+      break;
+    case SYMMETRY_VERTICAL:
+      lineBufferStencil<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>
+        (input, lbOutput, FoldedConv<ElemType, NumKernelRows, NumKernelCols, SYMMETRY_VERTICAL>(kernel));
+      break;
+    case SYMMETRY_BOTH:
+      lineBufferStencil<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>
+        (input, lbOutput, FoldedConv<ElemType, NumKernelRows, NumKernelCols, SYMMETRY_BOTH>(kernel));
+      break;
+    default:
+      lineBufferConvStream<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(input, kernel, lbOutput);
+      break;
+    }
+  }
+
+  // As above, with the symmetries found by inspecting the kernel.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols, typename Source, typename Sink>
+  void lineBufferConvSymmetric(Source& input,
+                               const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel,
+                               Sink& lbOutput) {
+    lineBufferConvSymmetric<ElemType, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>
+      (input, kernel, lbOutput, kernelSymmetry(kernel));
+  }
+
+}
@@ -0,0 +1,531 @@
+#pragma once
+
+#include "lb.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  // stdio buffer size for video streams. Pipes from a decoder deliver a
+  // few KB per read() at most, so a large buffer lets stdio gather whole
+  // frames per refill instead of a system call per row.
+  const int VIDEO_IO_BUFFER_BYTES = 4 << 20;
+
+  enum ChromaFormat {
+    CHROMA_MONO,
+    CHROMA_420,
+    CHROMA_422,
+    CHROMA_444
+  };
+
+  constexpr int numPlanes(const ChromaFormat c) {
+    return c == CHROMA_MONO ? 1 : 3;
+  }
+
+  constexpr int chromaShiftRows(const ChromaFormat c) {
+    return c == CHROMA_420 ? 1 : 0;
+  }
+
+  constexpr int chromaShiftCols(const ChromaFormat c) {
+    return c == CHROMA_420 || c == CHROMA_422 ? 1 : 0;
+  }
+
+  // Chroma planes round up, so odd sized 4:2:0 frames keep their last
+  // row and column of chroma.
+  constexpr int planeRows(const ChromaFormat c, const int plane, const int lumaRows) {
+    return plane == 0 ? lumaRows : (lumaRows + (1 << chromaShiftRows(c)) - 1) >> chromaShiftRows(c);
+  }
+
+  constexpr int planeCols(const ChromaFormat c, const int plane, const int lumaCols) {
+    return plane == 0 ? lumaCols : (lumaCols + (1 << chromaShiftCols(c)) - 1) >> chromaShiftCols(c);
+  }
+
+  // Geometry and sample format of a planar YUV stream.
+  class VideoFormat {
+  public:
+    int width;
+    int height;
+    ChromaFormat chroma;
+    int bitDepth;
+    int fpsNum;
+    int fpsDen;
+    char interlace;
+    string aspect;
+
+    VideoFormat() :
+      width(0), height(0), chroma(CHROMA_420), bitDepth(8), fpsNum(25), fpsDen(1), interlace('p'), aspect("0:0") {}
+
+    VideoFormat(const int width_, const int height_, const ChromaFormat chroma_, const int bitDepth_ = 8) :
+      width(width_), height(height_), chroma(chroma_), bitDepth(bitDepth_), fpsNum(25), fpsDen(1), interlace('p'), aspect("0:0") {}
+
+    int planes() const { return numPlanes(chroma); }
+    int rows(const int plane) const { return planeRows(chroma, plane, height); }
+    int cols(const int plane) const { return planeCols(chroma, plane, width); }
+
+    int bytesPerSample() const { return bitDepth > 8 ? 2 : 1; }
+    int maxValue() const { return (1 << bitDepth) - 1; }
+
+    long frameBytes() const {
+      long samples = 0;
+      for (int p = 0; p < planes(); p++) {
+        samples += (long) rows(p)*cols(p);
+      }
+      return samples*bytesPerSample();
+    }
+
+    // The Y4M C tag, e.g. 420jpeg, 422p10 or mono16.
+    string colorspaceTag() const {
+      const char* names[] = {"mono", "420", "422", "444"};
+      string tag = names[chroma];
+      if (bitDepth > 8) {
+        return tag + (chroma == CHROMA_MONO ? "" : "p") + to_string(bitDepth);
+      }
+      return chroma == CHROMA_420 ? tag + "jpeg" : tag;
+    }
+
+    bool parseColorspaceTag(const string& tag) {
+      const char* names[] = {"mono", "420", "422", "444"};
+      for (int c = 0; c < 4; c++) {
+        string name = names[c];
+        if (tag.compare(0, name.size(), name) != 0) {
+          continue;
+        }
+
+        chroma = (ChromaFormat) c;
+        string rest = tag.substr(name.size());
+        if (!rest.empty() && rest[0] == 'p') {
+          rest = rest.substr(1);
+        }
+        bitDepth = !rest.empty() && isdigit(rest[0]) ? atoi(rest.c_str()) : 8;
+        return 8 <= bitDepth && bitDepth <= 16;
+      }
+      return false;
+    }
+  };
+
+  // A buffered byte stream from a file, a named pipe, or stdin for "-".
+  class VideoInput {
+
+    FILE* file;
+    bool owned;
+
+  public:
+
+    VideoInput(const string& path) : file(nullptr), owned(path != "-") {
+      file = owned ? fopen(path.c_str(), "rb") : stdin;
+      if (file != nullptr) {
+        setvbuf(file, nullptr, _IOFBF, VIDEO_IO_BUFFER_BYTES);
+      }
+    }
+
+    ~VideoInput() {
+      if (owned && file != nullptr) {
+        fclose(file);
+      }
+    }
+
+    VideoInput(const VideoInput&) = delete;
+    VideoInput& operator=(const VideoInput&) = delete;
+
+    bool isValid() const { return file != nullptr; }
+
+    bool read(void* dst, const size_t bytes) {
+      return fread(dst, 1, bytes, file) == bytes;
+    }
+
+    // Reads up to and excluding the next newline. Fails at end of stream.
+    bool readLine(string& line) {
+      line.clear();
+      int c = fgetc(file);
+      if (c == EOF) {
+        return false;
+      }
+      while (c != EOF && c != '\n') {
+        line.push_back(c);
+        c = fgetc(file);
+      }
+      return c == '\n';
+    }
+
+    bool atEnd() {
+      int c = fgetc(file);
+      if (c == EOF) {
+        return true;
+      }
+      ungetc(c, file);
+      return false;
+    }
+  };
+
+  // A buffered byte stream to a file, a named pipe, or stdout for "-".
+  class VideoOutput {
+
+    FILE* file;
+    bool owned;
+
+  public:
+
+    VideoOutput(const string& path) : file(nullptr), owned(path != "-") {
+      file = owned ? fopen(path.c_str(), "wb") : stdout;
+      if (file != nullptr) {
+        setvbuf(file, nullptr, _IOFBF, VIDEO_IO_BUFFER_BYTES);
+      }
+    }
+
+    ~VideoOutput() {
+      if (file != nullptr) {
+        owned ? fclose(file) : fflush(file);
+      }
+    }
+
+    VideoOutput(const VideoOutput&) = delete;
+    VideoOutput& operator=(const VideoOutput&) = delete;
+
+    bool isValid() const { return file != nullptr; }
+
+    bool write(const void* src, const size_t bytes) {
+      return fwrite(src, 1, bytes, file) == bytes;
+    }
+
+    bool flush() {
+      return fflush(file) == 0;
+    }
+  };
+
+  // Unpacks a row of 8 bit or little endian 16 bit samples.
+  template<typename ElemType>
+  void unpackVideoSamples(const unsigned char* bytes, const int bytesPerSample, const int n, ElemType* row) {
+    if (bytesPerSample == 1) {
+      for (int i = 0; i < n; i++) {
+        row[i] = bytes[i];
+      }
+    } else {
+      for (int i = 0; i < n; i++) {
+        row[i] = bytes[2*i] | (bytes[2*i + 1] << 8);
+      }
+    }
+  }
+
+  // Reads the planes of each frame row by row, Y then U then V. Frames
+  // must be read completely and in order.
+  class PlanarVideoReader {
+
+  protected:
+
+    VideoInput in;
+    VideoFormat fmt;
+    bool valid;
+    vector<unsigned char> rowBytes;
+
+    PlanarVideoReader(const string& path) : in(path), valid(false) {}
+
+    void allocate() {
+      rowBytes.resize(fmt.cols(0)*fmt.bytesPerSample());
+    }
+
+  public:
+
+    bool isValid() const { return valid; }
+    const VideoFormat& format() const { return fmt; }
+
+    template<typename ElemType>
+    bool readRow(const int plane, ElemType* row) {
+      const int n = fmt.cols(plane);
+      if (!valid || !in.read(rowBytes.data(), n*fmt.bytesPerSample())) {
+        valid = false;
+        return false;
+      }
+
+      unpackVideoSamples(rowBytes.data(), fmt.bytesPerSample(), n, row);
+      return true;
+    }
+  };
+
+  // A YUV4MPEG2 stream: a header line, then each frame as a FRAME line
+  // followed by the raw planes.
+  class Y4mReader : public PlanarVideoReader {
+  public:
+
+    Y4mReader(const string& path) : PlanarVideoReader(path) {
+      string header;
+      if (!in.isValid() || !in.readLine(header) || header.compare(0, 10, "YUV4MPEG2 ") != 0) {
+        return;
+      }
+
+      istringstream tokens(header.substr(10));
+      string t;
+      bool ok = true;
+      while (tokens >> t) {
+        if (t[0] == 'W') {
+          fmt.width = atoi(t.c_str() + 1);
+        } else if (t[0] == 'H') {
+          fmt.height = atoi(t.c_str() + 1);
+        } else if (t[0] == 'F') {
+          ok = ok && sscanf(t.c_str() + 1, "%d:%d", &fmt.fpsNum, &fmt.fpsDen) == 2;
+        } else if (t[0] == 'I' && t.size() == 2) {
+          fmt.interlace = t[1];
+        } else if (t[0] == 'A') {
+          fmt.aspect = t.substr(1);
+        } else if (t[0] == 'C') {
+          ok = ok && fmt.parseColorspaceTag(t.substr(1));
+        }
+      }
+
+      valid = ok && fmt.width > 0 && fmt.height > 0;
+      allocate();
+    }
+
+    // Consumes the next FRAME line. Returns false at the end of the
+    // stream or on a malformed frame header.
+    bool nextFrame() {
+      string line;
+      if (!valid || !in.readLine(line)) {
+        return false;
+      }
+      if (line.compare(0, 5, "FRAME") != 0) {
+        valid = false;
+        return false;
+      }
+      return true;
+    }
+  };
+
+  // Headerless planar YUV, as from ffmpeg -f rawvideo. The geometry has to
+  // be supplied by the caller.
+  class RawYuvReader : public PlanarVideoReader {
+  public:
+
+    RawYuvReader(const string& path, const VideoFormat& format) : PlanarVideoReader(path) {
+      fmt = format;
+      valid = in.isValid() && fmt.width > 0 && fmt.height > 0;
+      allocate();
+    }
+
+    bool nextFrame() {
+      return valid && !in.atEnd();
+    }
+  };
+
+  // Writes a YUV4MPEG2 stream that ffmpeg and friends can read from a
+  // pipe. Samples are clamped to the format's bit depth.
+  class Y4mWriter {
+
+    VideoOutput out;
+    VideoFormat fmt;
+    bool valid;
+    vector<unsigned char> rowBytes;
+
+  public:
+
+    Y4mWriter(const string& path, const VideoFormat& format) : out(path), fmt(format), valid(false) {
+      rowBytes.resize(fmt.cols(0)*fmt.bytesPerSample());
+      if (!out.isValid()) {
+        return;
+      }
+
+      string header = "YUV4MPEG2 W" + to_string(fmt.width) + " H" + to_string(fmt.height) +
+        " F" + to_string(fmt.fpsNum) + ":" + to_string(fmt.fpsDen) +
+        " I" + string(1, fmt.interlace) + " A" + fmt.aspect +
+        " C" + fmt.colorspaceTag() + "\n";
+      valid = out.write(header.data(), header.size());
+    }
+
+    bool isValid() const { return valid; }
+    const VideoFormat& format() const { return fmt; }
+
+    bool beginFrame() {
+      valid = valid && out.write("FRAME\n", 6);
+      return valid;
+    }
+
+    bool writeRow(const int plane, const int* row) {
+      const int n = fmt.cols(plane);
+      const int maxVal = fmt.maxValue();
+      for (int i = 0; i < n; i++) {
+        int v = row[i];
+        v = v < 0 ? 0 : (v > maxVal ? maxVal : v);
+        if (fmt.bytesPerSample() == 1) {
+          rowBytes[i] = v;
+        } else {
+          rowBytes[2*i] = v & 0xff;
+          rowBytes[2*i + 1] = v >> 8;
+        }
+      }
+
+      valid = valid && out.write(rowBytes.data(), n*fmt.bytesPerSample());
+      return valid;
+    }
+
+    bool flush() {
+      return valid && out.flush();
+    }
+  };
+
+  // Feeds one plane of the current frame to a line buffer engine.
+  template<typename ElemType, typename Reader>
+  class VideoPlaneSource {
+
+    Reader& reader;
+    int plane;
+    int rowsLeft;
+    vector<ElemType>& row;
+    int index;
+    bool empty;
+
+    void nextRow() {
+      index = 0;
+      empty = rowsLeft == 0 || !reader.readRow(plane, row.data());
+      rowsLeft--;
+    }
+
+  public:
+
+    VideoPlaneSource(Reader& reader_, const int plane_, vector<ElemType>& rowBuffer) :
+      reader(reader_), plane(plane_), rowsLeft(reader_.format().rows(plane_)), row(rowBuffer) {
+      nextRow();
+    }
+
+    ElemType read() const {
+      return row[index];
+    }
+
+    void pop() {
+      index++;
+      if (index == reader.format().cols(plane)) {
+        nextRow();
+      }
+    }
+
+    bool isEmpty() const {
+      return empty;
+    }
+
+    bool endOfFrame() const {
+      return rowsLeft == 0 && index == reader.format().cols(plane) - 1;
+    }
+  };
+
+  // Takes the valid region of a convolved plane and writes it back out at
+  // the full plane size, replicating the edge pixels into the margins the
+  // kernel could not reach, so a filter keeps the stream's geometry.
+  // Results are kept as the engine's int sums so that writeRow clamps the
+  // real value rather than one already wrapped to the element type.
+  class PaddedPlaneSink {
+
+    Y4mWriter& writer;
+    int plane;
+    int marginRows;
+    int marginCols;
+    int validRows;
+    int validCols;
+    vector<int>& row;
+    int index;
+    int rowsDone;
+
+  public:
+
+    PaddedPlaneSink(Y4mWriter& writer_, const int plane_, const int marginRows_, const int marginCols_,
+                    vector<int>& rowBuffer) :
+      writer(writer_), plane(plane_), marginRows(marginRows_), marginCols(marginCols_),
+      validRows(writer_.format().rows(plane_) - 2*marginRows_),
+      validCols(writer_.format().cols(plane_) - 2*marginCols_),
+      row(rowBuffer), index(0), rowsDone(0) {}
+
+    void write(const int value) {
+      row[marginCols + index] = value;
+      index++;
+      if (index < validCols) {
+        return;
+      }
+
+      for (int j = 0; j < marginCols; j++) {
+        row[j] = row[marginCols];
+        row[marginCols + validCols + j] = row[marginCols + validCols - 1];
+      }
+
+      int copies = 1 + (rowsDone == 0 ? marginRows : 0) + (rowsDone == validRows - 1 ? marginRows : 0);
+      for (int c = 0; c < copies; c++) {
+        writer.writeRow(plane, row.data());
+      }
+
+      index = 0;
+      rowsDone++;
+    }
+
+    void endFrame() {}
+  };
+
+  // Convolves every plane of every frame of a video stream with one
+  // kernel. The plane geometry is fixed at compile time like the rest of
+  // the engines. Each plane has one line buffer for the whole stream, so
+  // every frame's first rows go into a buffer that is already warm with
+  // the previous frame's last rows instead of a freshly primed one.
+  template<typename ElemType, int NumKernelRows, int NumKernelCols, int NumRows, int NumCols, ChromaFormat Chroma>
+  class VideoConvPipeline {
+
+    const static int MARGIN_ROWS = NumKernelRows / 2;
+    const static int MARGIN_COLS = NumKernelCols / 2;
+
+    template<int Plane>
+    using PlaneConv = FrameStreamConv<ElemType, NumKernelRows, NumKernelCols,
+                                      planeRows(Chroma, Plane, NumRows), planeCols(Chroma, Plane, NumCols)>;
+
+    PlaneConv<0> lumaConv;
+    PlaneConv<1> cbConv;
+    PlaneConv<2> crConv;
+
+    vector<ElemType> inRow;
+    vector<int> outRow;
+
+    template<int Plane, typename Reader>
+    void convPlane(Reader& reader, Y4mWriter& writer, PlaneConv<Plane>& conv) {
+      VideoPlaneSource<ElemType, Reader> source(reader, Plane, inRow);
+      PaddedPlaneSink sink(writer, Plane, MARGIN_ROWS, MARGIN_COLS, outRow);
+      conv.run(source, sink);
+    }
+
+  public:
+
+    VideoConvPipeline(const Mem2D<ElemType, NumKernelRows, NumKernelCols>& kernel) :
+      lumaConv(kernel), cbConv(kernel), crConv(kernel), inRow(NumCols), outRow(NumCols) {}
+
+    static bool matches(const VideoFormat& f) {
+      return f.width == NumCols && f.height == NumRows && f.chroma == Chroma;
+    }
+
+    // Processes frames until the reader runs out. Returns the number of
+    // frames written, or -1 on a format mismatch or I/O error.
+    template<typename Reader>
+    long run(Reader& reader, Y4mWriter& writer) {
+      if (!reader.isValid() || !writer.isValid() ||
+          !matches(reader.format()) || !matches(writer.format())) {
+        return -1;
+      }
+
+      long frames = 0;
+      while (reader.nextFrame()) {
+        writer.beginFrame();
+        convPlane<0>(reader, writer, lumaConv);
+        if (numPlanes(Chroma) == 3) {
+          convPlane<1>(reader, writer, cbConv);
+          convPlane<2>(reader, writer, crConv);
+        }
+
+        if (!reader.isValid() || !writer.isValid()) {
+          return -1;
+        }
+        frames++;
+      }
+
+      return reader.isValid() && writer.flush() ? frames : -1;
+    }
+  };
+
+}
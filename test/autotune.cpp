@@ -0,0 +1,137 @@
+#include "catch.hpp"
+
+#include "autotune.h"
+#include "conv_check.h"
+#include "example_vectors.h"
+#include "temp_path.h"
+
+using namespace std;
+
+namespace swlb {
+
+  const int PLAN_ROWS = 20;
+  const int PLAN_COLS = 150;
+
+  template<int K>
+  void checkEveryCandidateMatchesBulk(const Mem2D<int, K, K>& kernel, const int expectedCandidates) {
+    typedef Mem2D<int, PLAN_ROWS - 2*(K / 2), PLAN_COLS - 2*(K / 2)> Output;
+
+    Mem2D<int, PLAN_ROWS, PLAN_COLS> input = patternedImage<PLAN_ROWS, PLAN_COLS>();
+
+    ThreadPool pool(3);
+    vector<ConvPlan> candidates = convCandidates<int, K, K, PLAN_ROWS, PLAN_COLS>(kernel);
+    REQUIRE((int) candidates.size() == expectedCandidates);
+
+    for (auto& candidate : candidates) {
+      Output output;
+      REQUIRE(runConvPlan(candidate, input, kernel, output, pool));
+      requireMatchesBulk(input, kernel, output);
+    }
+
+    Output output;
+    REQUIRE(!runConvPlan(ConvPlan("no-such-engine", 0), input, kernel, output, pool));
+  }
+
+  TEST_CASE("Every autotuner candidate computes the same convolution") {
+    // Sparse and symmetric, with the register window engine: bulk,
+    // linebuffer, sparse, symmetric, linebuffer3x3, fft, tiled at 64 and
+    // parallel.
+    Mem2D<int, 3, 3> cross;
+    cross.set(0, 1, 1);
+    cross.set(1, 0, 2);
+    cross.set(1, 1, -4);
+    cross.set(1, 2, 2);
+    cross.set(2, 1, 1);
+    checkEveryCandidateMatchesBulk(cross, 8);
+
+    // Dense and asymmetric: bulk, linebuffer, fft, tiled at 64 and
+    // parallel.
+    Mem2D<int, 5, 5> dense;
+    for (int i = 0; i < 5; i++) {
+      for (int j = 0; j < 5; j++) {
+        dense.set(i, j, i*5 + j + 1);
+      }
+    }
+    checkEveryCandidateMatchesBulk(dense, 5);
+  }
+
+  TEST_CASE("Plans are tuned once and reloaded from the plan file") {
+    const string path = tempTestPath("plans.txt");
+    remove(path.c_str());
+
+    Mem2D<int, PLAN_ROWS, PLAN_COLS> input = patternedImage<PLAN_ROWS, PLAN_COLS>();
+    Mem2D<int, 3, 3> kernel;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        kernel.set(i, j, i - 2*j);
+      }
+    }
+
+    ThreadPool pool(2);
+    ConvPlan tuned;
+    {
+      ConvPlanner planner(path, "Test CPU A", 1);
+      Mem2D<int, PLAN_ROWS - 2, PLAN_COLS - 2> output;
+      tuned = planner.run(input, kernel, output, pool);
+      REQUIRE(planner.tunings() == 1);
+      REQUIRE(!tuned.engine.empty());
+
+      planner.run(input, kernel, output, pool);
+      REQUIRE(planner.tunings() == 1);
+      requireMatchesBulk(input, kernel, output);
+    }
+
+    // A later run on the same CPU goes straight to the saved engine.
+    {
+      ConvPlanner planner(path, "Test CPU A", 1);
+      Mem2D<int, PLAN_ROWS - 2, PLAN_COLS - 2> output;
+      ConvPlan loaded = planner.run(input, kernel, output, pool);
+      REQUIRE(planner.tunings() == 0);
+      REQUIRE(loaded.engine == tuned.engine);
+      REQUIRE(loaded.param == tuned.param);
+      requireMatchesBulk(input, kernel, output);
+    }
+
+    // Another CPU tunes for itself and keeps the first CPU's plan.
+    {
+      ConvPlanner planner(path, "Test CPU B", 1);
+      Mem2D<int, PLAN_ROWS - 2, PLAN_COLS - 2> output;
+      planner.run(input, kernel, output, pool);
+      REQUIRE(planner.tunings() == 1);
+    }
+    {
+      ConvPlanner planner(path, "Test CPU A", 1);
+      ConvPlan kept;
+      REQUIRE(planner.lookup(ConvPlanner::configKey<int, 3, 3, PLAN_ROWS, PLAN_COLS>(kernel), kept));
+      REQUIRE(kept.engine == tuned.engine);
+    }
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("A plan for an unknown engine is tuned again") {
+    const string path = tempTestPath("stale-plans.txt");
+    remove(path.c_str());
+
+    Mem2D<int, PLAN_ROWS, PLAN_COLS> input = patternedImage<PLAN_ROWS, PLAN_COLS>();
+    Mem2D<int, 3, 3> kernel;
+    kernel.set(1, 1, 3);
+
+    {
+      ConvPlanner planner(path, "Test CPU A", 1);
+      planner.record(ConvPlanner::configKey<int, 3, 3, PLAN_ROWS, PLAN_COLS>(kernel), ConvPlan("retired-engine", 7));
+      REQUIRE(planner.save());
+    }
+
+    ThreadPool pool(1);
+    ConvPlanner planner(path, "Test CPU A", 1);
+    Mem2D<int, PLAN_ROWS - 2, PLAN_COLS - 2> output;
+    ConvPlan p = planner.run(input, kernel, output, pool);
+    REQUIRE(planner.tunings() == 1);
+    REQUIRE(p.engine != "retired-engine");
+    REQUIRE(output(5, 6) == 3*input(6, 7));
+
+    remove(path.c_str());
+  }
+
+}
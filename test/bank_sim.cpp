@@ -0,0 +1,91 @@
+#include "catch.hpp"
+
+#include "bank_sim.h"
+
+using namespace std;
+
+namespace swlb {
+
+  TEST_CASE("increment walks RAM addresses in order and wraps") {
+    BankedLineBuffer lb;
+    lb.lbSize = 12;
+    lb.ramWidth = 4;
+
+    RAMAddr addr = lb.ramAddress(0);
+    for (int i = 0; i < 2*lb.lbSize; i++) {
+      RAMAddr expected = lb.ramAddress(i % lb.lbSize);
+      REQUIRE(addr.ramNumber == expected.ramNumber);
+      REQUIRE(addr.indexInRAM == expected.indexInRAM);
+      REQUIRE(addr.numRAMs == 3);
+      REQUIRE(addr.ramWidth == 4);
+      addr = increment(addr);
+    }
+  }
+
+  const int SIM_ROWS = 12;
+  const int SIM_COLS = 20;
+
+  TEST_CASE("One line RAM per kernel row sustains a pixel per clock with simple dual port RAMs") {
+    // The classic FPGA layout: two RAMs of one image row each, read first,
+    // with the window in registers.
+    BankedLineBuffer lb = imageBuffer3x3Banks<SIM_ROWS, SIM_COLS>(SIMPLE_DUAL_PORT);
+    lb.lbSize = 2*SIM_COLS;
+
+    BankSimReport report = simulateBanks(lb);
+    REQUIRE(report.pixels == SIM_ROWS*SIM_COLS);
+    REQUIRE(report.outputs == (SIM_ROWS - 2)*(SIM_COLS - 2));
+    REQUIRE(report.conflictPixels == 0);
+    REQUIRE(report.initiationInterval() == 1);
+    REQUIRE(report.pixelsPerClock() == 1);
+
+    REQUIRE(report.banks.size() == 2);
+    for (auto& bank : report.banks) {
+      REQUIRE(bank.peakReads == 1);
+      REQUIRE(bank.peakWrites == 1);
+      REQUIRE(bank.writes == SIM_ROWS*SIM_COLS / 2);
+    }
+
+    // The bottom tap of every entering column is the pixel being written.
+    const int windowPixels = SIM_ROWS*SIM_COLS - (2*SIM_COLS + 2);
+    REQUIRE(report.forwardedReads == windowPixels);
+  }
+
+  TEST_CASE("The same layout on single port RAMs stalls on every read") {
+    BankedLineBuffer lb = imageBuffer3x3Banks<SIM_ROWS, SIM_COLS>(SINGLE_PORT);
+    lb.lbSize = 2*SIM_COLS;
+
+    BankSimReport report = simulateBanks(lb);
+    const int windowPixels = SIM_ROWS*SIM_COLS - (2*SIM_COLS + 2);
+    REQUIRE(report.conflictPixels == windowPixels);
+    REQUIRE(report.stallCycles == windowPixels);
+    REQUIRE(report.cycles == SIM_ROWS*SIM_COLS + windowPixels);
+    REQUIRE(report.initiationInterval() > 1.5);
+  }
+
+  TEST_CASE("ImageBuffer3x3's banks never need two reads of one RAM") {
+    BankSimReport report = simulateBanks(imageBuffer3x3Banks<SIM_ROWS, SIM_COLS>(SIMPLE_DUAL_PORT));
+    REQUIRE(report.banks.size() == 3);
+    REQUIRE(report.conflictPixels == 0);
+    REQUIRE(report.outputs == (SIM_ROWS - 2)*(SIM_COLS - 2));
+    for (auto& bank : report.banks) {
+      REQUIRE(bank.peakReads <= 1);
+    }
+  }
+
+  TEST_CASE("Reading whole windows from the banks caps the pixel rate") {
+    BankSimReport dual = simulateBanks(imageBufferBanks<3, 3, SIM_ROWS, SIM_COLS>(TRUE_DUAL_PORT));
+    REQUIRE(dual.outputs == (SIM_ROWS - 2)*(SIM_COLS - 2));
+    REQUIRE(dual.conflictPixels > 0);
+    REQUIRE(dual.pixelsPerClock() < 1);
+
+    BankSimReport single = simulateBanks(imageBufferBanks<3, 3, SIM_ROWS, SIM_COLS>(SINGLE_PORT));
+    REQUIRE(single.cycles > dual.cycles);
+
+    long reads = 0;
+    for (auto& bank : single.banks) {
+      reads += bank.reads;
+    }
+    REQUIRE(reads + single.forwardedReads == 9*single.outputs);
+  }
+
+}
@@ -0,0 +1,85 @@
+#include "catch.hpp"
+
+#include "baseline.h"
+#include "temp_path.h"
+
+#include <cstdio>
+
+using namespace std;
+
+namespace swlb {
+
+  BenchResult syntheticResult(const vector<double>& samples) {
+    BenchResult r;
+    r.engine = "linebuffer";
+    r.elemType = "int32";
+    r.size = "vga";
+    r.kernel = 3;
+    r.nsPerPixel = samples;
+    return r;
+  }
+
+  TEST_CASE("Parsing the JSON the harness writes") {
+    JsonValue v;
+    REQUIRE(parseJson("{\"a\": [1, 2.5, null], \"b\": {\"c\": \"x\\\"y\"}, \"d\": true}", v));
+    REQUIRE(v.kind == JsonValue::JSON_OBJECT);
+    REQUIRE(v["a"].items.size() == 3);
+    REQUIRE(v["a"].items[1].number == 2.5);
+    REQUIRE(v["a"].items[2].kind == JsonValue::JSON_NULL);
+    REQUIRE(v["b"]["c"].str == "x\"y");
+    REQUIRE(v["d"].boolean);
+    REQUIRE(!v.has("e"));
+
+    JsonValue bad;
+    REQUIRE(!parseJson("{\"a\": ", bad));
+  }
+
+  TEST_CASE("Baselines survive a save and load") {
+    string path = tempTestPath("baseline.json");
+    remove(path.c_str());
+
+    BenchResult r = syntheticResult({10.0, 11.0, 12.0});
+    r.countersPerPixel[PERF_CYCLES] = 40;
+
+    REQUIRE(saveBaseline(path, "before", {r}));
+    REQUIRE(saveBaseline(path, "after", {syntheticResult({5.0, 5.0})}));
+
+    map<string, Baseline> baselines;
+    REQUIRE(loadBaselines(path, baselines));
+    REQUIRE(baselines.size() == 2);
+
+    const BaselineEntry& entry = baselines["before"]["linebuffer/int32/vga/3x3"];
+    REQUIRE(entry.reps == 3);
+    REQUIRE(entry.median == Approx(11.0));
+    REQUIRE(entry.stddev == Approx(1.0));
+    REQUIRE(entry.countersPerPixel[PERF_CYCLES] == Approx(40));
+    REQUIRE(entry.countersPerPixel[PERF_INSTRUCTIONS] < 0);
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("A large slowdown relative to the noise is a regression") {
+    BaselineEntry base = baselineEntry(syntheticResult({10.0, 10.1, 9.9, 10.0, 10.05}));
+    BaselineComparison c = compareToBaseline(base, syntheticResult({11.0, 11.1, 10.9, 11.0, 10.95}));
+    REQUIRE(c.verdict == VERDICT_REGRESSION);
+    REQUIRE(c.percentChange() > 9);
+  }
+
+  TEST_CASE("The same slowdown inside noisy repetitions is not flagged") {
+    BaselineEntry base = baselineEntry(syntheticResult({8.0, 12.0, 10.0, 7.0, 13.0}));
+    BaselineComparison c = compareToBaseline(base, syntheticResult({9.0, 13.0, 11.0, 8.0, 14.0}));
+    REQUIRE(c.verdict == VERDICT_UNCHANGED);
+  }
+
+  TEST_CASE("A significant speedup is an improvement") {
+    BaselineEntry base = baselineEntry(syntheticResult({10.0, 10.1, 9.9}));
+    BaselineComparison c = compareToBaseline(base, syntheticResult({8.0, 8.1, 7.9}));
+    REQUIRE(c.verdict == VERDICT_IMPROVEMENT);
+  }
+
+  TEST_CASE("Single repetitions cannot be judged") {
+    BaselineEntry base = baselineEntry(syntheticResult({10.0}));
+    REQUIRE(compareToBaseline(base, syntheticResult({20.0, 21.0})).verdict == VERDICT_TOO_FEW_REPS);
+  }
+
+}
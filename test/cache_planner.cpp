@@ -0,0 +1,43 @@
+#include "catch.hpp"
+
+#include "cache_planner.h"
+
+using namespace std;
+
+namespace swlb {
+
+  TEST_CASE("Parsing sysfs cache sizes") {
+    REQUIRE(parseCacheSize("48K") == 48*1024);
+    REQUIRE(parseCacheSize("2M") == 2*1024*1024);
+    REQUIRE(parseCacheSize("512") == 512);
+    REQUIRE(parseCacheSize("") == 0);
+    REQUIRE(parseCacheSize("cache") == 0);
+  }
+
+  TEST_CASE("Detected cache sizes are positive and ordered") {
+    const CacheInfo& info = hostCacheInfo();
+    REQUIRE(info.l1dBytes > 0);
+    REQUIRE(info.l2Bytes > 0);
+    REQUIRE(info.l3Bytes > 0);
+    REQUIRE(info.l1dBytes <= info.l2Bytes);
+    REQUIRE(info.bytes(L2_CACHE) == info.l2Bytes);
+  }
+
+  TEST_CASE("Planner keeps full width strips when the line buffer fits") {
+    StripPlanner planner(1024*1024);
+    REQUIRE(planner.stripCols(sizeof(int), 3, 3, 638) == 638);
+  }
+
+  TEST_CASE("Planner narrows strips of wide images to fit the budget") {
+    StripPlanner planner(64*1024);
+    int cols = planner.stripCols(sizeof(int), 5, 5, 16380);
+    REQUIRE(cols < 16380);
+    REQUIRE(tileWorkingSetBytes(sizeof(int), 5, 5, cols) <= 64*1024);
+    REQUIRE((cols & (cols - 1)) == 0);
+  }
+
+  TEST_CASE("Full width planner never splits columns") {
+    REQUIRE(StripPlanner::fullWidth().stripCols(sizeof(int), 15, 15, 1 << 20) == (1 << 20));
+  }
+
+}
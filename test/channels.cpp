@@ -0,0 +1,158 @@
+#include "catch.hpp"
+
+#include "channels.h"
+#include "pnm.h"
+#include "temp_path.h"
+
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  class SampleSink {
+  public:
+    vector<int> samples;
+
+    void write(const int value) {
+      samples.push_back(value);
+    }
+  };
+
+  template<int NumChannels, int NumRows, int NumCols>
+  void interleavedTestImage(CircularFIFO<int, NumRows*NumCols*NumChannels>& fifo,
+                            Mem2D<int, NumRows, NumCols> planes[NumChannels]) {
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        for (int c = 0; c < NumChannels; c++) {
+          int v = (i*NumCols*7 + j*5 + c*41) % 97;
+          planes[c].set(i, j, v);
+          fifo.write(v);
+        }
+      }
+    }
+  }
+
+  TEST_CASE("Interleaved RGB convolution matches per plane convolution") {
+    const int NROWS = 7;
+    const int NCOLS = 9;
+    const int OUT_ROWS = NROWS - 2;
+    const int OUT_COLS = NCOLS - 4;
+
+    CircularFIFO<int, NROWS*NCOLS*3> input;
+    Mem2D<int, NROWS, NCOLS> planes[3];
+    interleavedTestImage<3, NROWS, NCOLS>(input, planes);
+
+    ChannelKernels<int, 3, 3, 5> kernels;
+    for (int c = 0; c < 3; c++) {
+      Mem2D<int, 3, 5> kernel;
+      for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 5; j++) {
+          kernel.set(i, j, (c + 1)*(i - j) + c);
+        }
+      }
+      kernels.set(c, kernel);
+    }
+
+    SampleSink output;
+    lineBufferConvChannels<int, 3, 3, 5, NROWS, NCOLS>(input, kernels, output);
+    REQUIRE(output.samples.size() == OUT_ROWS*OUT_COLS*3);
+
+    for (int c = 0; c < 3; c++) {
+      Mem2D<int, OUT_ROWS, OUT_COLS> expected;
+      bulkConv<int, 3, 5, NROWS, NCOLS>(planes[c], kernels[c], expected);
+      for (int i = 0; i < OUT_ROWS; i++) {
+        for (int j = 0; j < OUT_COLS; j++) {
+          REQUIRE(output.samples[(i*OUT_COLS + j)*3 + c] == expected(i, j));
+        }
+      }
+    }
+  }
+
+  TEST_CASE("RGBA with a shared kernel and planar output") {
+    const int NROWS = 6;
+    const int NCOLS = 8;
+    const int OUT_ROWS = NROWS - 2;
+    const int OUT_COLS = NCOLS - 2;
+
+    CircularFIFO<int, NROWS*NCOLS*4> input;
+    Mem2D<int, NROWS, NCOLS> planes[4];
+    interleavedTestImage<4, NROWS, NCOLS>(input, planes);
+
+    Mem2D<int, 3, 3> kernel;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        kernel.set(i, j, 3*i + j - 4);
+      }
+    }
+
+    SampleSink sinks[4];
+    SampleSink* const outputs[4] = {&sinks[0], &sinks[1], &sinks[2], &sinks[3]};
+    lineBufferConvChannelsPlanar<int, 4, 3, 3, NROWS, NCOLS>(input, ChannelKernels<int, 4, 3, 3>(kernel), outputs);
+
+    for (int c = 0; c < 4; c++) {
+      Mem2D<int, OUT_ROWS, OUT_COLS> expected;
+      bulkConv<int, 3, 3, NROWS, NCOLS>(planes[c], kernel, expected);
+
+      REQUIRE(sinks[c].samples.size() == OUT_ROWS*OUT_COLS);
+      for (int i = 0; i < OUT_ROWS; i++) {
+        for (int j = 0; j < OUT_COLS; j++) {
+          REQUIRE(sinks[c].samples[i*OUT_COLS + j] == expected(i, j));
+        }
+      }
+    }
+  }
+
+  TEST_CASE("PPM file convolution keeps channels separate") {
+    const int NROWS = 5;
+    const int NCOLS = 6;
+    string inPath = tempTestPath("rgb-in.ppm");
+    string outPath = tempTestPath("rgb-out.ppm");
+
+    {
+      PnmWriter writer(inPath, NCOLS, NROWS, 3, 255);
+      for (int i = 0; i < NROWS; i++) {
+        vector<int> row;
+        for (int j = 0; j < NCOLS; j++) {
+          row.push_back(10 + i);
+          row.push_back(100 + j);
+          row.push_back(200);
+        }
+        writer.writeRow(row.data());
+      }
+    }
+
+    // Pick out the center pixel of each channel, shifted by one column
+    // for green.
+    ChannelKernels<int, 3, 3, 3> kernels;
+    Mem2D<int, 3, 3> center;
+    center.set(1, 1, 1);
+    Mem2D<int, 3, 3> right;
+    right.set(1, 2, 1);
+    kernels.set(0, center);
+    kernels.set(1, right);
+    kernels.set(2, center);
+
+    {
+      PnmReader reader(inPath);
+      PnmWriter writer(outPath, NCOLS - 2, NROWS - 2, 3, 255);
+      REQUIRE((lineBufferConvPnm<int, 3, 3, NROWS, NCOLS>(reader, kernels, writer)));
+    }
+
+    PnmReader result(outPath);
+    REQUIRE(result.channels() == 3);
+    for (int i = 0; i < NROWS - 2; i++) {
+      vector<int> row(result.rowSamples());
+      REQUIRE(result.readRow(row.data()));
+      for (int j = 0; j < NCOLS - 2; j++) {
+        REQUIRE(row[3*j] == 10 + i + 1);
+        REQUIRE(row[3*j + 1] == 100 + j + 2);
+        REQUIRE(row[3*j + 2] == 200);
+      }
+    }
+
+    remove(inPath.c_str());
+    remove(outPath.c_str());
+  }
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "catch.hpp"
+
+#include "lb.h"
+
+using namespace std;
+
+namespace swlb {
+
+  // Requires output to be exactly bulkConv's result for image and
+  // kernel: every pixel, in raster order, and nothing after it.
+  template<int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  void requireMatchesBulk(const Mem2D<int, NumImageRows, NumImageCols>& image,
+                          const Mem2D<int, NumKernelRows, NumKernelCols>& kernel,
+                          CircularFIFO<int, (NumImageRows - 2*(NumKernelRows / 2))*(NumImageCols - 2*(NumKernelCols / 2))>& output) {
+    const int OUT_ROWS = NumImageRows - 2*(NumKernelRows / 2);
+    const int OUT_COLS = NumImageCols - 2*(NumKernelCols / 2);
+
+    Mem2D<int, OUT_ROWS, OUT_COLS> correct;
+    bulkConv<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(image, kernel, correct);
+
+    for (int i = 0; i < OUT_ROWS; i++) {
+      for (int j = 0; j < OUT_COLS; j++) {
+        REQUIRE(!output.isEmpty());
+        REQUIRE(output.read() == correct(i, j));
+        output.pop();
+      }
+    }
+    REQUIRE(output.isEmpty());
+  }
+
+  // The same for engines that write a Mem2D.
+  template<int NumKernelRows, int NumKernelCols, int NumImageRows, int NumImageCols>
+  void requireMatchesBulk(const Mem2D<int, NumImageRows, NumImageCols>& image,
+                          const Mem2D<int, NumKernelRows, NumKernelCols>& kernel,
+                          const Mem2D<int, NumImageRows - 2*(NumKernelRows / 2), NumImageCols - 2*(NumKernelCols / 2)>& output) {
+    const int OUT_ROWS = NumImageRows - 2*(NumKernelRows / 2);
+    const int OUT_COLS = NumImageCols - 2*(NumKernelCols / 2);
+
+    Mem2D<int, OUT_ROWS, OUT_COLS> correct;
+    bulkConv<int, NumKernelRows, NumKernelCols, NumImageRows, NumImageCols>(image, kernel, correct);
+
+    for (int i = 0; i < OUT_ROWS; i++) {
+      for (int j = 0; j < OUT_COLS; j++) {
+        REQUIRE(output(i, j) == correct(i, j));
+      }
+    }
+  }
+
+}
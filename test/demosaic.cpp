@@ -0,0 +1,167 @@
+#include "catch.hpp"
+
+#include "channels.h"
+#include "demosaic.h"
+
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  class RgbSink {
+  public:
+    vector<int> samples;
+
+    void write(const int value) {
+      samples.push_back(value);
+    }
+  };
+
+  // A smooth, linear color image: every demosaic that is exact on
+  // gradients must reproduce it in the interior.
+  static int rampColor(const int c, const int i, const int j) {
+    return 100 + (c + 1)*3*i + (3 - c)*2*j;
+  }
+
+  template<int NumRows, int NumCols>
+  void mosaic(const CfaPhase phase, CircularFIFO<int, NumRows*NumCols>& out) {
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        out.write(rampColor(cfaColor(phase, ((i & 1) << 1) | (j & 1)), i, j));
+      }
+    }
+  }
+
+  template<int KernelSize>
+  void checkRampReproduced(const DemosaicKernels<KernelSize>& kernels) {
+    const int NROWS = 10;
+    const int NCOLS = 12;
+    const int MARGIN = KernelSize / 2;
+    const int OUT_COLS = NCOLS - 2*MARGIN;
+
+    CfaPhase phases[4] = {CFA_RGGB, CFA_BGGR, CFA_GRBG, CFA_GBRG};
+    for (CfaPhase phase : phases) {
+      CircularFIFO<int, NROWS*NCOLS> input;
+      mosaic<NROWS, NCOLS>(phase, input);
+
+      RgbSink output;
+      lineBufferDemosaic<KernelSize, NROWS, NCOLS>(input, kernels, phase, 1023, output);
+      REQUIRE(output.samples.size() == 3*(NROWS - 2*MARGIN)*OUT_COLS);
+
+      for (int i = MARGIN; i < NROWS - MARGIN; i++) {
+        for (int j = MARGIN; j < NCOLS - MARGIN; j++) {
+          for (int c = 0; c < 3; c++) {
+            REQUIRE(output.samples[3*((i - MARGIN)*OUT_COLS + (j - MARGIN)) + c] == rampColor(c, i, j));
+          }
+        }
+      }
+    }
+  }
+
+  TEST_CASE("CFA sites for every phase") {
+    REQUIRE(cfaSite(CFA_RGGB, 0) == SITE_RED);
+    REQUIRE(cfaSite(CFA_RGGB, 1) == SITE_GREEN_RED_ROW);
+    REQUIRE(cfaSite(CFA_RGGB, 2) == SITE_GREEN_BLUE_ROW);
+    REQUIRE(cfaSite(CFA_RGGB, 3) == SITE_BLUE);
+
+    REQUIRE(cfaSite(CFA_BGGR, 0) == SITE_BLUE);
+    REQUIRE(cfaSite(CFA_BGGR, 1) == SITE_GREEN_BLUE_ROW);
+
+    REQUIRE(cfaSite(CFA_GRBG, 0) == SITE_GREEN_RED_ROW);
+    REQUIRE(cfaSite(CFA_GRBG, 2) == SITE_BLUE);
+
+    REQUIRE(cfaSite(CFA_GBRG, 0) == SITE_GREEN_BLUE_ROW);
+    REQUIRE(cfaSite(CFA_GBRG, 2) == SITE_RED);
+  }
+
+  TEST_CASE("Demosaic kernels sum to the fixed point scale") {
+    DemosaicKernels<3> bilinear = bilinearDemosaicKernels();
+    DemosaicKernels<5> mhc = malvarHeCutlerKernels();
+    for (int s = 0; s < NUM_CFA_SITES; s++) {
+      for (int c = 0; c < 3; c++) {
+        int bilinearSum = 0;
+        int mhcSum = 0;
+        for (int i = 0; i < 5; i++) {
+          for (int j = 0; j < 5; j++) {
+            if (i < 3 && j < 3) {
+              bilinearSum += bilinear((CfaSite) s, (CfaColor) c)(i, j);
+            }
+            mhcSum += mhc((CfaSite) s, (CfaColor) c)(i, j);
+          }
+        }
+        REQUIRE(bilinearSum == DEMOSAIC_SCALE);
+        REQUIRE(mhcSum == DEMOSAIC_SCALE);
+      }
+    }
+  }
+
+  TEST_CASE("Bilinear demosaic reproduces a color ramp for every CFA phase") {
+    checkRampReproduced(bilinearDemosaicKernels());
+  }
+
+  TEST_CASE("Malvar-He-Cutler demosaic reproduces a color ramp for every CFA phase") {
+    checkRampReproduced(malvarHeCutlerKernels());
+  }
+
+  TEST_CASE("Malvar-He-Cutler demosaic of an edge matches the published filters") {
+    const int NROWS = 8;
+    const int NCOLS = 8;
+
+    // A vertical edge: dark on the left, bright on the right.
+    CircularFIFO<int, NROWS*NCOLS> input;
+    int mosaicImage[NROWS][NCOLS];
+    for (int i = 0; i < NROWS; i++) {
+      for (int j = 0; j < NCOLS; j++) {
+        mosaicImage[i][j] = j < 4 ? 40 : 200;
+        input.write(mosaicImage[i][j]);
+      }
+    }
+
+    RgbSink output;
+    lineBufferDemosaic<5, NROWS, NCOLS>(input, malvarHeCutlerKernels(), CFA_RGGB, 255, output);
+
+    auto at = [&](const int i, const int j) { return mosaicImage[i][j]; };
+
+    // Green at the red site (2, 2), written out from the paper's filter.
+    int g = (4*at(2, 2) + 2*(at(1, 2) + at(3, 2) + at(2, 1) + at(2, 3))
+             - (at(0, 2) + at(4, 2) + at(2, 0) + at(2, 4)) + 4) >> 3;
+    REQUIRE(output.samples[1] == g);
+
+    // Red at the green site (2, 3) in a red row.
+    int r = (10*at(2, 3) + 8*(at(2, 2) + at(2, 4))
+             - 2*(at(1, 2) + at(1, 4) + at(3, 2) + at(3, 4) + at(2, 1) + at(2, 5))
+             + (at(0, 3) + at(4, 3)) + 8) >> 4;
+    REQUIRE(output.samples[3] == min(max(r, 0), 255));
+  }
+
+  TEST_CASE("Planar demosaic output matches interleaved") {
+    const int NROWS = 9;
+    const int NCOLS = 11;
+
+    CircularFIFO<int, NROWS*NCOLS> a;
+    CircularFIFO<int, NROWS*NCOLS> b;
+    for (int i = 0; i < NROWS*NCOLS; i++) {
+      a.write((i*37) % 256);
+      b.write((i*37) % 256);
+    }
+
+    RgbSink interleaved;
+    lineBufferDemosaic<5, NROWS, NCOLS>(a, malvarHeCutlerKernels(), CFA_GBRG, 255, interleaved);
+
+    RgbSink planes[3];
+    RgbSink* const outputs[3] = {&planes[0], &planes[1], &planes[2]};
+    PlanarChannelSink<RgbSink, 3> planar(outputs);
+    lineBufferDemosaic<5, NROWS, NCOLS>(b, malvarHeCutlerKernels(), CFA_GBRG, 255, planar);
+
+    for (int c = 0; c < 3; c++) {
+      REQUIRE(planes[c].samples.size() == interleaved.samples.size() / 3);
+      for (size_t p = 0; p < planes[c].samples.size(); p++) {
+        REQUIRE(planes[c].samples[p] == interleaved.samples[3*p + c]);
+        REQUIRE(0 <= planes[c].samples[p]);
+        REQUIRE(planes[c].samples[p] <= 255);
+      }
+    }
+  }
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "lb.h"
+
+using namespace std;
+
+namespace swlb {
+
+  // The image and kernels the convolution tests in lb.cpp run on. The
+  // HLS testbenches swlb-hls generates use them too, so the C simulation
+  // checks the same data.
+
+  const int NROWS = 8;
+  const int NCOLS = 10;
+
+  inline
+  Mem2D<int, 3, 3> exampleKernel() {
+    Mem2D<int, 3, 3> kernel;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        kernel.set(i, j, i + j);
+      }
+    }
+
+    return kernel;
+  }
+
+  inline
+  Mem2D<int, 5, 5> exampleKernel5x5() {
+    Mem2D<int, 5, 5> kernel;
+    for (int i = 0; i < 5; i++) {
+      for (int j = 0; j < 5; j++) {
+        kernel.set(i, j, i*5 + j - 12);
+      }
+    }
+
+    return kernel;
+  }
+
+  // Pixels 1, 2, 3, ... in raster order.
+  template<int NumRows, int NumCols>
+  Mem2D<int, NumRows, NumCols> sequentialImage() {
+    Mem2D<int, NumRows, NumCols> input;
+    int val = 1;
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        input.set(i, j, val);
+        val++;
+      }
+    }
+
+    return input;
+  }
+
+  // Signed pixels in [-48, 48] with no short period along rows or
+  // columns, so that taps landing on the wrong pixel show up in the sums.
+  template<int NumRows, int NumCols>
+  Mem2D<int, NumRows, NumCols> patternedImage() {
+    Mem2D<int, NumRows, NumCols> input;
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        input.set(i, j, (i*NumCols + j)*53 % 97 - 48);
+      }
+    }
+
+    return input;
+  }
+
+  inline
+  Mem2D<int, NROWS, NCOLS> exampleInput() {
+    return sequentialImage<NROWS, NCOLS>();
+  }
+
+  // Streams mem into buf in raster order.
+  template<typename ElemType, int NumRows, int NumCols>
+  void fill(CircularFIFO<ElemType, NumRows*NumCols>& buf,
+            const Mem2D<ElemType, NumRows, NumCols>& mem) {
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        buf.write(mem(i, j));
+      }
+    }
+  }
+
+}
@@ -0,0 +1,89 @@
+#include "catch.hpp"
+
+#include "conv_check.h"
+#include "example_vectors.h"
+#include "fft_conv.h"
+
+using namespace std;
+
+namespace swlb {
+
+  TEST_CASE("The FFT matches a direct DFT and inverts") {
+    const int N = 16;
+    FFT fft(N);
+
+    vector<complex<double> > x(N);
+    for (int i = 0; i < N; i++) {
+      x[i] = complex<double>((i*7) % 11 - 5, (i*3) % 5);
+    }
+
+    vector<complex<double> > X(x);
+    fft.transform(&X[0], false);
+    for (int k = 0; k < N; k++) {
+      complex<double> expected(0, 0);
+      for (int i = 0; i < N; i++) {
+        expected += x[i]*polar(1.0, -2*M_PI*i*k / N);
+      }
+      REQUIRE(abs(X[k] - expected) < 1e-9);
+    }
+
+    fft.transform(&X[0], true);
+    for (int i = 0; i < N; i++) {
+      REQUIRE(abs(X[i] / (double) N - x[i]) < 1e-9);
+    }
+  }
+
+  TEST_CASE("Transforming the columns of a grid transforms each column") {
+    const int N = 8;
+    const int COLS = 5;
+    FFT fft(N);
+
+    vector<complex<double> > grid(N*COLS);
+    for (int i = 0; i < N*COLS; i++) {
+      grid[i] = complex<double>((i*13) % 17, -(i % 3));
+    }
+
+    vector<complex<double> > columns(grid);
+    fft.transformColumns(&columns[0], COLS, false);
+
+    for (int j = 0; j < COLS; j++) {
+      vector<complex<double> > column(N);
+      for (int i = 0; i < N; i++) {
+        column[i] = grid[i*COLS + j];
+      }
+      fft.transform(&column[0], false);
+      for (int i = 0; i < N; i++) {
+        REQUIRE(abs(columns[i*COLS + j] - column[i]) < 1e-9);
+      }
+    }
+  }
+
+  template<int KR, int KC, int NumRows, int NumCols>
+  void checkFFTMatchesBulk() {
+    Mem2D<int, KR, KC> kernel;
+    for (int r = 0; r < KR; r++) {
+      for (int c = 0; c < KC; c++) {
+        kernel.set(r, c, (r*KC + c)*31 % 19 - 9);
+      }
+    }
+
+    Mem2D<int, NumRows, NumCols> image = patternedImage<NumRows, NumCols>();
+    CircularFIFO<int, NumRows*NumCols> in;
+    fill(in, image);
+
+    CircularFIFO<int, (NumRows - 2*(KR / 2))*(NumCols - 2*(KC / 2))> out;
+    lineBufferConvFFT<int, KR, KC, NumRows, NumCols>(in, kernel, out);
+    REQUIRE(in.isEmpty());
+
+    requireMatchesBulk(image, kernel, out);
+  }
+
+  TEST_CASE("FFT convolution is exact and laid out like bulkConv") {
+    // One partial strip, then several strips with a partial pair at the end.
+    checkFFTMatchesBulk<3, 3, 10, 12>();
+    checkFFTMatchesBulk<15, 15, 150, 37>();
+    checkFFTMatchesBulk<17, 5, 200, 64>();
+    checkFFTMatchesBulk<1, 9, 70, 20>();
+  }
+
+}
@@ -0,0 +1,124 @@
+#include "catch.hpp"
+
+#include "filter_bank.h"
+
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  class BankSink {
+  public:
+    vector<int> samples;
+
+    void write(const int value) {
+      samples.push_back(value);
+    }
+  };
+
+  template<int NumRows, int NumCols>
+  void bankTestImage(CircularFIFO<int, NumRows*NumCols>& fifo) {
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        fifo.write((i*i*3 + j*11 + i*j) % 89);
+      }
+    }
+  }
+
+  TEST_CASE("A Sobel bank matches one lineBufferConv pass per kernel") {
+    const int NROWS = 9;
+    const int NCOLS = 12;
+    const int NUM_OUT = (NROWS - 2)*(NCOLS - 2);
+
+    const int sobelX[3][3] = {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}};
+    FilterBank<int, 2, 3, 3> bank;
+    Mem2D<int, 3, 3> kx;
+    Mem2D<int, 3, 3> ky;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        kx.set(i, j, sobelX[i][j]);
+        ky.set(i, j, sobelX[j][i]);
+      }
+    }
+    bank.set(0, kx);
+    bank.set(1, ky);
+
+    CircularFIFO<int, NROWS*NCOLS> xIn;
+    bankTestImage<NROWS, NCOLS>(xIn);
+    CircularFIFO<int, NUM_OUT> xOut;
+    lineBufferConv<int, 3, 3, NROWS, NCOLS>(xIn, kx, xOut);
+
+    CircularFIFO<int, NROWS*NCOLS> yIn;
+    bankTestImage<NROWS, NCOLS>(yIn);
+    CircularFIFO<int, NUM_OUT> yOut;
+    lineBufferConv<int, 3, 3, NROWS, NCOLS>(yIn, ky, yOut);
+
+    CircularFIFO<int, NROWS*NCOLS> bankIn;
+    bankTestImage<NROWS, NCOLS>(bankIn);
+    BankSink interleaved;
+    lineBufferConvBank<int, 2, 3, 3, NROWS, NCOLS>(bankIn, bank, interleaved);
+
+    CircularFIFO<int, NROWS*NCOLS> planarIn;
+    bankTestImage<NROWS, NCOLS>(planarIn);
+    BankSink gx;
+    BankSink gy;
+    BankSink* const planes[2] = {&gx, &gy};
+    lineBufferConvBankPlanar<int, 2, 3, 3, NROWS, NCOLS>(planarIn, bank, planes);
+
+    REQUIRE(interleaved.samples.size() == 2*NUM_OUT);
+    REQUIRE(gx.samples.size() == NUM_OUT);
+    REQUIRE(gy.samples.size() == NUM_OUT);
+    for (int p = 0; p < NUM_OUT; p++) {
+      REQUIRE(interleaved.samples[2*p] == xOut.read());
+      REQUIRE(interleaved.samples[2*p + 1] == yOut.read());
+      REQUIRE(gx.samples[p] == xOut.read());
+      REQUIRE(gy.samples[p] == yOut.read());
+      xOut.pop();
+      yOut.pop();
+    }
+  }
+
+  TEST_CASE("A bank of rectangular kernels matches bulkConv") {
+    const int NROWS = 8;
+    const int NCOLS = 11;
+    const int NUM_KERNELS = 3;
+    const int OUT_ROWS = NROWS - 4;
+    const int OUT_COLS = NCOLS - 2;
+
+    Mem2D<int, NROWS, NCOLS> image;
+    CircularFIFO<int, NROWS*NCOLS> input;
+    for (int i = 0; i < NROWS; i++) {
+      for (int j = 0; j < NCOLS; j++) {
+        image.set(i, j, (i*NCOLS + j*7) % 23);
+        input.write(image(i, j));
+      }
+    }
+
+    FilterBank<int, NUM_KERNELS, 5, 3> bank;
+    for (int k = 0; k < NUM_KERNELS; k++) {
+      Mem2D<int, 5, 3> kernel;
+      for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 3; j++) {
+          kernel.set(i, j, (k + 1)*i - j*k + 1);
+        }
+      }
+      bank.set(k, kernel);
+    }
+
+    BankSink output;
+    lineBufferConvBank<int, NUM_KERNELS, 5, 3, NROWS, NCOLS>(input, bank, output);
+    REQUIRE(output.samples.size() == NUM_KERNELS*OUT_ROWS*OUT_COLS);
+
+    for (int k = 0; k < NUM_KERNELS; k++) {
+      Mem2D<int, OUT_ROWS, OUT_COLS> expected;
+      bulkConv<int, 5, 3, NROWS, NCOLS>(image, bank[k], expected);
+      for (int i = 0; i < OUT_ROWS; i++) {
+        for (int j = 0; j < OUT_COLS; j++) {
+          REQUIRE(output.samples[NUM_KERNELS*(i*OUT_COLS + j) + k] == expected(i, j));
+        }
+      }
+    }
+  }
+
+}
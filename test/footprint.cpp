@@ -0,0 +1,93 @@
+#include "catch.hpp"
+
+#include "footprint.h"
+
+#include <cstdint>
+
+using namespace std;
+
+namespace swlb {
+
+  // Checked when this file compiles.
+  static_assert(cacheBudget(DEFAULT_L2_BYTES).admits(lineBufferConvFootprint<int16_t, 5, 5, 1080, 1920>()),
+                "a 5x5 1080p line buffer fits in L2");
+  static_assert(!cacheBudget(DEFAULT_L2_BYTES).admits(storageFootprint<Mem2D<int16_t, 1080, 1920> >()),
+                "a 1080p frame does not fit in L2");
+  static_assert(lineBufferConvFootprint<int16_t, 7, 3, 1080, 1920>().lines == 7 - 1,
+                "the kernel adds no lines to a line buffer convolution");
+  static_assert(bramBudget(8).admits(storageFootprint<ImageBuffer3x3<int16_t, 1080, 1920> >()),
+                "ImageBuffer3x3 at 1080p fits in 8 BRAMs");
+
+  TEST_CASE("Block RAM counts follow the 18Kb configurations") {
+    REQUIRE(bram18Count(4, 32) == 0);
+    REQUIRE(bram18Count(32, 32) == 0);
+    REQUIRE(bram18Count(512, 36) == 1);
+    REQUIRE(bram18Count(640, 16) == 1);
+    REQUIRE(bram18Count(640, 32) == 2);
+    REQUIRE(bram18Count(1920, 16) == 2);
+    REQUIRE(bram18Count(3840, 8) == 2);
+    REQUIRE(bram18Count(7680, 16) == 8);
+    REQUIRE(bram18Count(20000, 8) == 16);
+  }
+
+  TEST_CASE("Buffer footprints") {
+    typedef ImageBuffer<int16_t, 5, 5, 1080, 1920> Buffer5x5;
+    constexpr Footprint lb = storageFootprint<Buffer5x5>();
+    REQUIRE(lb.bytes == (long) sizeof(Buffer5x5));
+    REQUIRE(lb.bytes >= (long) ((4*1920 + 2 + 5)*sizeof(int16_t)));
+    REQUIRE(lb.lines == 4);
+    REQUIRE(lb.registers == 7);
+    REQUIRE(lb.brams == 8);
+
+    typedef ImageBuffer3x3<int32_t, 480, 640> Buffer3x3;
+    constexpr Footprint regs = storageFootprint<Buffer3x3>();
+    REQUIRE(regs.bytes == (long) sizeof(Buffer3x3));
+    REQUIRE(regs.lines == 2);
+    REQUIRE(regs.registers == 4 + 9);
+    REQUIRE(regs.brams == 4);
+
+    constexpr Footprint fifo = storageFootprint<CircularFIFO<int16_t, 1000> >();
+    REQUIRE(fifo.bytes == (long) sizeof(CircularFIFO<int16_t, 1000>));
+    REQUIRE(fifo.lines == 0);
+    REQUIRE(fifo.brams == 1);
+
+    constexpr Footprint frame = storageFootprint<Mem2D<int16_t, 480, 640> >();
+    REQUIRE(frame.bytes == 480*640*(long) sizeof(int16_t));
+    REQUIRE(frame.lines == 480);
+    REQUIRE(frame.brams == 480);
+
+    constexpr Footprint kernel = kernelFootprint<int, 3, 3>();
+    REQUIRE(kernel.bytes == 9*(long) sizeof(int));
+    REQUIRE(kernel.lines == 0);
+    REQUIRE(kernel.registers == 9);
+    REQUIRE(kernel.brams == 0);
+  }
+
+  TEST_CASE("Pipeline footprints add up their stages") {
+    typedef CircularFIFO<int, 20*30> In;
+    typedef ImageBuffer<int, 3, 3, 20, 30> Buffer;
+    typedef CircularFIFO<int, 18*28> Out;
+
+    constexpr Footprint total = pipelineFootprint<In, Buffer, Out>();
+    REQUIRE(total.bytes == (long) (sizeof(In) + sizeof(Buffer) + sizeof(Out)));
+    REQUIRE(total.lines == 2);
+    REQUIRE(total.registers == 4);
+    REQUIRE(total.brams == storageFootprint<In>().brams + storageFootprint<Out>().brams);
+
+    constexpr Footprint conv = lineBufferConvFootprint<int, 3, 3, 20, 30>();
+    REQUIRE(conv.bytes == (long) (sizeof(Buffer) + sizeof(Mem2D<int, 3, 3>)));
+    REQUIRE(conv.lines == 3 - 1);
+    REQUIRE(conv.registers == 4 + 9);
+
+    constexpr Footprint conv5 = lineBufferConvFootprint<int16_t, 5, 5, 1080, 1920>();
+    REQUIRE(conv5.lines == 5 - 1);
+    REQUIRE(conv5.registers == 7 + 25);
+    REQUIRE(conv5.brams == 8);
+
+    REQUIRE(cacheBudget(total.bytes).admits(total));
+    REQUIRE(!cacheBudget(total.bytes - 1).admits(total));
+    REQUIRE(FootprintBudget(total.bytes, total.brams).admits(total));
+    REQUIRE(!FootprintBudget(total.bytes, total.brams - 1).admits(total));
+  }
+
+}
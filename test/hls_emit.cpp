@@ -0,0 +1,77 @@
+#include "catch.hpp"
+
+#include "hls_emit.h"
+
+#include <sstream>
+
+using namespace std;
+
+namespace swlb {
+
+  static HlsConvConfig sobelConfig() {
+    Mem2D<int, 3, 3> sobel;
+    sobel.set(0, 0, -1);
+    sobel.set(0, 2, 1);
+    sobel.set(1, 0, -2);
+    sobel.set(1, 2, 2);
+    sobel.set(2, 0, -1);
+    sobel.set(2, 2, 1);
+    return hlsConvConfig<int, 3, 3, 6, 7>("sobel", "short", sobel);
+  }
+
+  static int count(const string& text, const string& what) {
+    int n = 0;
+    for (size_t at = text.find(what); at != string::npos; at = text.find(what, at + 1)) {
+      n++;
+    }
+    return n;
+  }
+
+  TEST_CASE("Emitted HLS has fixed arrays, partitioned line RAMs and an II=1 pixel loop") {
+    ostringstream out;
+    emitHlsConv(out, sobelConfig());
+    const string code = out.str();
+
+    REQUIRE(code.find("void sobel(const short in[42], short out[20])") != string::npos);
+    REQUIRE(code.find("static short lines[2][7];") != string::npos);
+    REQUIRE(code.find("#pragma HLS ARRAY_PARTITION variable=lines complete dim=1") != string::npos);
+    REQUIRE(code.find("static short window[3][3];") != string::npos);
+    REQUIRE(code.find("#pragma HLS ARRAY_PARTITION variable=window complete dim=0") != string::npos);
+    REQUIRE(count(code, "#pragma HLS PIPELINE II=1") == 1);
+
+    // Each line RAM is read once and written once per pixel.
+    REQUIRE(count(code, "= lines[0][col];") == 1);
+    REQUIRE(count(code, "lines[0][col] =") == 1);
+    REQUIRE(count(code, "= lines[1][col];") == 1);
+    REQUIRE(count(code, "lines[1][col] =") == 1);
+
+    // Six non-zero taps, with the unit taps not multiplied.
+    REQUIRE(count(code, "acc += ") == 6);
+    REQUIRE(code.find("acc += -2*window[1][0];") != string::npos);
+    REQUIRE(code.find("acc += window[0][2];") != string::npos);
+    REQUIRE(code.find("window[0][1]") == string::npos);
+  }
+
+  TEST_CASE("The emitted testbench carries the input and the software model's output") {
+    Mem2D<int, 6, 7> image;
+    for (int i = 0; i < 6; i++) {
+      for (int j = 0; j < 7; j++) {
+        image.set(i, j, i*7 + j);
+      }
+    }
+    Mem2D<int, 3, 3> kernel;
+    kernel.set(1, 2, 3);
+
+    HlsConvConfig config = hlsConvConfig<int, 3, 3, 6, 7>("shift", "int", kernel);
+    ostringstream out;
+    emitHlsTestbench(out, config, image, kernel);
+    const string tb = out.str();
+
+    REQUIRE(tb.find("void shift(const int in[42], int out[20]);") != string::npos);
+    REQUIRE(tb.find("static const int input[42] = {\n  0, 1, 2, 3, 4, 5, 6,\n  7,") != string::npos);
+    // out(0, 0) is 3*image(1, 2).
+    REQUIRE(tb.find("static const int expected[20] = {\n  27, 30, 33, 36, 39,\n  48,") != string::npos);
+    REQUIRE(tb.find("PASS") != string::npos);
+  }
+
+}
@@ -2,9 +2,12 @@
 
 #include "catch.hpp"
 
+#include "conv_check.h"
+#include "example_vectors.h"
 #include "lb.h"
 
 #include <iostream>
+#include <vector>
 
 using namespace std;
 
@@ -139,48 +142,10 @@ namespace swlb {
   }
 
   const int KERNEL_WIDTH = 3;
-    
-  const int NROWS = 8;
-  const int NCOLS = 10;
   
   const int OUT_ROWS = NROWS - 2;
   const int OUT_COLS = NCOLS - 2;
 
-  template<typename ElemType, int NumRows, int NumCols>
-  void fill(CircularFIFO<ElemType, NumRows*NumCols>& buf,
-            const Mem2D<ElemType, NumRows, NumCols>& mem) {
-    for (int i = 0; i < NumRows; i++) {
-      for (int j = 0; j < NumCols; j++) {
-        buf.write(mem(i, j));
-      }
-    }
-  }
-
-  Mem2D<int, 3, 3> exampleKernel() {
-    Mem2D<int, 3, 3> kernel;
-    for (int i = 0; i < KERNEL_WIDTH; i++) {
-      for (int j = 0; j < KERNEL_WIDTH; j++) {
-        kernel.set(i, j, i + j);
-      }
-    }
-
-    return kernel;
-  }
-
-  Mem2D<int, NROWS, NCOLS> exampleInput() {
-    Mem2D<int, NROWS, NCOLS> input;
-    //vector<int> input;
-    int val = 1;
-    for (int i = 0; i < NROWS; i++) {
-      for (int j = 0; j < NCOLS; j++) {
-        input.set(i, j, val);
-        val++;
-      }
-    }
-
-    return input;
-  }
-
   TEST_CASE("Using linebuffer for convolution") {
 
     Mem2D<int, NROWS, NCOLS> input = exampleInput();
@@ -256,5 +221,307 @@ namespace swlb {
     }
     
   }
+
+  TEST_CASE("bulkConv matches lineBufferConv for a 5x5 kernel") {
+    const int K5_OUT_ROWS = NROWS - 4;
+    const int K5_OUT_COLS = NCOLS - 4;
+
+    Mem2D<int, NROWS, NCOLS> input = exampleInput();
+    Mem2D<int, 5, 5> kernel = exampleKernel5x5();
+
+    Mem2D<int, K5_OUT_ROWS, K5_OUT_COLS> correctOutput;
+    bulkConv<int, 5, 5, NROWS, NCOLS>(input, kernel, correctOutput);
+
+    CircularFIFO<int, NROWS*NCOLS> inputBuf;
+    fill(inputBuf, input);
+
+    CircularFIFO<int, K5_OUT_ROWS*K5_OUT_COLS> lbOutput;
+    lineBufferConv<int, 5, 5, NROWS, NCOLS>(inputBuf, kernel, lbOutput);
+
+    for (int i = 0; i < K5_OUT_ROWS; i++) {
+      for (int j = 0; j < K5_OUT_COLS; j++) {
+        REQUIRE(lbOutput.read() == correctOutput(i, j));
+        lbOutput.pop();
+      }
+    }
+  }
+
+  template<int KernelSize>
+  class MacStencil {
+    const Mem2D<int, KernelSize, KernelSize>& kernel;
+
+  public:
+    MacStencil(const Mem2D<int, KernelSize, KernelSize>& kernel_) : kernel(kernel_) {}
+
+    template<typename Window>
+    int operator()(const Window& w) const {
+      int res = 0;
+      for (int row = 0; row < KernelSize; row++) {
+        for (int col = 0; col < KernelSize; col++) {
+          res += kernel(row, col)*w.at(row, col);
+        }
+      }
+      return res;
+    }
+  };
+
+  TEST_CASE("A multiply-accumulate stencil matches lineBufferConv") {
+    Mem2D<int, NROWS, NCOLS> input = exampleInput();
+    Mem2D<int, 3, 3> kernel = exampleKernel();
+
+    CircularFIFO<int, NROWS*NCOLS> convIn;
+    fill(convIn, input);
+    CircularFIFO<int, OUT_ROWS*OUT_COLS> convOut;
+    lineBufferConv<int, 3, 3, NROWS, NCOLS>(convIn, kernel, convOut);
+
+    CircularFIFO<int, NROWS*NCOLS> stencilIn;
+    fill(stencilIn, input);
+    CircularFIFO<int, OUT_ROWS*OUT_COLS> stencilOut;
+    lineBufferStencil<int, 3, 3, NROWS, NCOLS>(stencilIn, stencilOut, MacStencil<3>(kernel));
+
+    for (int i = 0; i < OUT_ROWS*OUT_COLS; i++) {
+      REQUIRE(stencilOut.read() == convOut.read());
+      stencilOut.pop();
+      convOut.pop();
+    }
+    REQUIRE(stencilOut.isEmpty());
+  }
+
+  TEST_CASE("Non-linear stencils see the window and its center") {
+    typedef StencilWindow<int, 3, 5, NROWS, NCOLS> Window;
+    const int OUT_COLS_3x5 = NCOLS - 4;
+
+    Mem2D<int, NROWS, NCOLS> input;
+    for (int i = 0; i < NROWS; i++) {
+      for (int j = 0; j < NCOLS; j++) {
+        input.set(i, j, (i*7 + j*13) % 17);
+      }
+    }
+
+    CircularFIFO<int, NROWS*NCOLS> maxIn;
+    fill(maxIn, input);
+    CircularFIFO<int, OUT_ROWS*OUT_COLS_3x5> maxOut;
+    lineBufferStencil<int, 3, 5, NROWS, NCOLS>(maxIn, maxOut, [](const Window& w) {
+        int m = w(-1, -2);
+        for (int row = -1; row <= 1; row++) {
+          for (int col = -2; col <= 2; col++) {
+            m = max(m, w(row, col));
+          }
+        }
+        return m;
+      });
+
+    CircularFIFO<int, NROWS*NCOLS> centerIn;
+    fill(centerIn, input);
+    CircularFIFO<int, OUT_ROWS*OUT_COLS_3x5> centerOut;
+    lineBufferStencil<int, 3, 5, NROWS, NCOLS>(centerIn, centerOut, [](const Window& w) {
+        return w.center().row*100 + w.center().col;
+      });
+
+    for (int i = 1; i < NROWS - 1; i++) {
+      for (int j = 2; j < NCOLS - 2; j++) {
+        int expected = 0;
+        for (int row = i - 1; row <= i + 1; row++) {
+          for (int col = j - 2; col <= j + 2; col++) {
+            expected = max(expected, input(row, col));
+          }
+        }
+        REQUIRE(maxOut.read() == expected);
+        maxOut.pop();
+
+        REQUIRE(centerOut.read() == i*100 + j);
+        centerOut.pop();
+      }
+    }
+  }
+
+  TEST_CASE("Resetting an imagebuffer starts a new frame") {
+    ImageBuffer<int, 3, 3, 10, 10> lb;
+    for (int i = 0; i < 10*2 + 3; i++) {
+      lb.write(i);
+    }
+    lb.pop();
+    REQUIRE(lb.nextReadCenter() == PixelLoc(1, 2));
+
+    lb.reset();
+    REQUIRE(lb.numValidEntries() == 0);
+    REQUIRE(lb.nextReadCenter() == PixelLoc(1, 1));
+
+    for (int i = 0; i < 10*2 + 3; i++) {
+      REQUIRE(!lb.windowValid());
+      lb.write(100 + i);
+    }
+
+    REQUIRE(lb.windowValid());
+    REQUIRE(lb.read(-1, -1) == 100);
+    REQUIRE(lb.read(1, 1) == 122);
+  }
+
+  TEST_CASE("Resetting an ImageBuffer3x3 clears its window") {
+    ImageBuffer3x3<int, 10, 10> lb;
+    for (int i = 0; i < 10*2 + 3; i++) {
+      lb.write(i + 1);
+    }
+    REQUIRE(lb.windowFull());
+
+    lb.reset();
+    REQUIRE(lb.numValidEntries() == 0);
+    REQUIRE(!lb.windowFull());
+    REQUIRE(lb.read(0, 0) == 0);
+  }
+
+  // Back to back frames with an optional in-band end of frame flag on
+  // the pixel where a frame is cut short.
+  class FrameStreamSource {
+  public:
+    vector<int> pixels;
+    vector<bool> last;
+    size_t index;
+
+    FrameStreamSource() : index(0) {}
+
+    void add(const int value, const bool endOfFrame = false) {
+      pixels.push_back(value);
+      last.push_back(endOfFrame);
+    }
+
+    int read() const { return pixels[index]; }
+    void pop() { index++; }
+    bool isEmpty() const { return index == pixels.size(); }
+    bool endOfFrame() const { return last[index]; }
+  };
+
+  class FrameStreamSink {
+  public:
+    vector<vector<int> > frames;
+
+    FrameStreamSink() : frames(1) {}
+
+    void write(const int value) { frames.back().push_back(value); }
+    void endFrame() { frames.push_back(vector<int>()); }
+  };
+
+  TEST_CASE("Back to back frames stream through one line buffer") {
+    const int K5_OUT_ROWS = NROWS - 4;
+    const int K5_OUT_COLS = NCOLS - 4;
+    const int NUM_FRAMES = 3;
+
+    Mem2D<int, 5, 5> kernel = exampleKernel5x5();
+
+    FrameStreamSource source;
+    vector<Mem2D<int, NROWS, NCOLS> > inputs(NUM_FRAMES);
+    for (int f = 0; f < NUM_FRAMES; f++) {
+      for (int i = 0; i < NROWS; i++) {
+        for (int j = 0; j < NCOLS; j++) {
+          inputs[f].set(i, j, (f*7 + i*NCOLS + j*3) % 29);
+          source.add(inputs[f](i, j));
+        }
+      }
+    }
+
+    FrameStreamSink sink;
+    REQUIRE((lineBufferConvFrames<int, 5, 5, NROWS, NCOLS>(source, kernel, sink)) == NUM_FRAMES);
+    REQUIRE(sink.frames.size() == NUM_FRAMES + 1);
+    REQUIRE(sink.frames.back().empty());
+
+    for (int f = 0; f < NUM_FRAMES; f++) {
+      Mem2D<int, K5_OUT_ROWS, K5_OUT_COLS> correctOutput;
+      bulkConv<int, 5, 5, NROWS, NCOLS>(inputs[f], kernel, correctOutput);
+
+      REQUIRE(sink.frames[f].size() == K5_OUT_ROWS*K5_OUT_COLS);
+      for (int i = 0; i < K5_OUT_ROWS; i++) {
+        for (int j = 0; j < K5_OUT_COLS; j++) {
+          REQUIRE(sink.frames[f][i*K5_OUT_COLS + j] == correctOutput(i, j));
+        }
+      }
+    }
+  }
+
+  TEST_CASE("A frame cut short by an in-band end of frame does not corrupt the next") {
+    Mem2D<int, NROWS, NCOLS> input = exampleInput();
+    Mem2D<int, 3, 3> kernel = exampleKernel();
+
+    Mem2D<int, OUT_ROWS, OUT_COLS> correctOutput;
+    bulkConv<int, KERNEL_WIDTH, KERNEL_WIDTH, NROWS, NCOLS>(input, kernel, correctOutput);
+
+    // Four rows of a frame, then a complete one.
+    FrameStreamSource source;
+    for (int i = 0; i < 4*NCOLS; i++) {
+      source.add(-i, i == 4*NCOLS - 1);
+    }
+    for (int i = 0; i < NROWS; i++) {
+      for (int j = 0; j < NCOLS; j++) {
+        source.add(input(i, j));
+      }
+    }
+
+    FrameStreamConv<int, 3, 3, NROWS, NCOLS> conv(kernel);
+    FrameStreamSink sink;
+    conv.run(source, sink);
+    REQUIRE(conv.frames() == 2);
+    REQUIRE(sink.frames[0].size() == 2*OUT_COLS);
+
+    REQUIRE(sink.frames[1].size() == OUT_ROWS*OUT_COLS);
+    for (int i = 0; i < OUT_ROWS; i++) {
+      for (int j = 0; j < OUT_COLS; j++) {
+        REQUIRE(sink.frames[1][i*OUT_COLS + j] == correctOutput(i, j));
+      }
+    }
+  }
+  
+  template<int K>
+  void checkSparseMatchesBulk(const Mem2D<int, K, K>& kernel, const int expectedTaps) {
+    const int SROWS = 12;
+    const int SCOLS = 15;
+
+    const SparseKernel<int, K, K> taps(kernel);
+    REQUIRE(taps.size() == expectedTaps);
+
+    Mem2D<int, SROWS, SCOLS> input = patternedImage<SROWS, SCOLS>();
+    CircularFIFO<int, SROWS*SCOLS> in;
+    fill(in, input);
+    CircularFIFO<int, (SROWS - 2*(K / 2))*(SCOLS - 2*(K / 2))> out;
+    lineBufferConv<int, K, K, SROWS, SCOLS>(in, kernel, out);
+
+    requireMatchesBulk(input, kernel, out);
+  }
+
+  TEST_CASE("Sparse kernels convolve only their non-zero taps") {
+    // A cross, unrolled.
+    Mem2D<int, 5, 5> cross;
+    for (int i = 0; i < 5; i++) {
+      cross.set(2, i, i - 3);
+      cross.set(i, 2, 2*i + 1);
+    }
+    checkSparseMatchesBulk(cross, 8);
+
+    // A ring, past the unrolled tap counts.
+    Mem2D<int, 7, 7> ring;
+    for (int i = 0; i < 7; i++) {
+      ring.set(0, i, i + 1);
+      ring.set(6, i, -i);
+      ring.set(i, 0, 3);
+      ring.set(i, 6, i*i - 5);
+    }
+    checkSparseMatchesBulk(ring, 24);
+
+    Mem2D<int, 3, 3> corner;
+    corner.set(0, 2, 7);
+    checkSparseMatchesBulk(corner, 1);
+
+    Mem2D<int, 3, 3> empty;
+    checkSparseMatchesBulk(empty, 0);
+
+    // Four taps is the most a 3x3 kernel can have and still go sparse.
+    Mem2D<int, 3, 3> diamond;
+    diamond.set(0, 1, 2);
+    diamond.set(1, 0, -1);
+    diamond.set(1, 2, 5);
+    diamond.set(2, 1, 3);
+    checkSparseMatchesBulk(diamond, 4);
+
+    // One zero in 25 taps stays on the dense engine.
+    checkSparseMatchesBulk(exampleKernel5x5(), 24);
+  }
   
 }
@@ -0,0 +1,156 @@
+#include "catch.hpp"
+
+#include "mapped_frame.h"
+#include "temp_path.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  template<typename ElemType>
+  static void writeRawFile(const string& path, const vector<ElemType>& pixels, const long headerBytes) {
+    FILE* f = fopen(path.c_str(), "wb");
+    for (long i = 0; i < headerBytes; i++) {
+      fputc('#', f);
+    }
+    fwrite(pixels.data(), sizeof(ElemType), pixels.size(), f);
+    fclose(f);
+  }
+
+  template<typename ElemType>
+  class VectorSink {
+  public:
+    vector<ElemType> pixels;
+
+    void write(const ElemType value) {
+      pixels.push_back(value);
+    }
+  };
+
+  TEST_CASE("Mapped frames view raw frames in place") {
+    const int NUM_ROWS = 4;
+    const int NUM_COLS = 6;
+    const long HEADER = 16;
+    string path = tempTestPath("frames.raw");
+
+    vector<int16_t> pixels;
+    for (int i = 0; i < 3*NUM_ROWS*NUM_COLS; i++) {
+      pixels.push_back(i);
+    }
+    writeRawFile(path, pixels, HEADER);
+
+    MappedFile file(path);
+    REQUIRE(file.isValid());
+    REQUIRE(file.size() == HEADER + 2*(long) pixels.size());
+
+    typedef MappedFrame<int16_t, NUM_ROWS, NUM_COLS> Frame;
+    REQUIRE(Frame::numFrames(file, HEADER) == 3);
+
+    Frame second(file, 1, HEADER);
+    REQUIRE(second.isValid());
+    REQUIRE(second.data() == (const int16_t*) (file.data() + HEADER) + NUM_ROWS*NUM_COLS);
+    REQUIRE(second(0, 0) == NUM_ROWS*NUM_COLS);
+    REQUIRE(second(2, 3) == NUM_ROWS*NUM_COLS + 2*NUM_COLS + 3);
+
+    REQUIRE(!Frame(file, 3, HEADER).isValid());
+    REQUIRE(!MappedFile(tempTestPath("missing.raw")).isValid());
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("Convolving a mapped frame matches lineBufferConv") {
+    const int NUM_ROWS = 9;
+    const int NUM_COLS = 13;
+    const int OUT_ROWS = NUM_ROWS - 4;
+    const int OUT_COLS = NUM_COLS - 4;
+    string path = tempTestPath("conv.raw");
+
+    vector<int> pixels;
+    CircularFIFO<int, NUM_ROWS*NUM_COLS> fifo;
+    for (int i = 0; i < 2*NUM_ROWS*NUM_COLS; i++) {
+      pixels.push_back((i*31) % 101 - 50);
+      if (i >= NUM_ROWS*NUM_COLS) {
+        fifo.write(pixels.back());
+      }
+    }
+    writeRawFile(path, pixels, 0);
+
+    Mem2D<int, 5, 5> kernel;
+    for (int i = 0; i < 5; i++) {
+      for (int j = 0; j < 5; j++) {
+        kernel.set(i, j, i - 2*j);
+      }
+    }
+
+    CircularFIFO<int, OUT_ROWS*OUT_COLS> expected;
+    lineBufferConv<int, 5, 5, NUM_ROWS, NUM_COLS>(fifo, kernel, expected);
+
+    MappedFile file(path);
+    MappedFrame<int, NUM_ROWS, NUM_COLS> frame(file, 1);
+    CircularFIFO<int, OUT_ROWS*OUT_COLS> output;
+    lineBufferConvMapped<int, 5, 5, NUM_ROWS, NUM_COLS>(frame, kernel, output);
+
+    for (int i = 0; i < OUT_ROWS*OUT_COLS; i++) {
+      REQUIRE(output.read() == expected.read());
+      output.pop();
+      expected.pop();
+    }
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("Mapped frames larger than the advice window convolve correctly") {
+    const int NUM_ROWS = 1200;
+    const int NUM_COLS = 2000;
+    const int OUT_ROWS = NUM_ROWS - 2;
+    const int OUT_COLS = NUM_COLS - 2;
+    string path = tempTestPath("large.raw");
+
+    REQUIRE(NUM_ROWS*NUM_COLS*sizeof(int) > 2*MAPPED_ADVICE_WINDOW_BYTES);
+
+    unique_ptr<Mem2D<int, NUM_ROWS, NUM_COLS>> image(new Mem2D<int, NUM_ROWS, NUM_COLS>());
+    vector<int> pixels;
+    for (int i = 0; i < NUM_ROWS; i++) {
+      for (int j = 0; j < NUM_COLS; j++) {
+        image->set(i, j, (i*7 + j*3) % 23);
+        pixels.push_back((*image)(i, j));
+      }
+    }
+    writeRawFile(path, pixels, 0);
+
+    Mem2D<int, 3, 3> kernel;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        kernel.set(i, j, i*3 + j);
+      }
+    }
+
+    unique_ptr<Mem2D<int, OUT_ROWS, OUT_COLS>> expected(new Mem2D<int, OUT_ROWS, OUT_COLS>());
+    bulkConv(*image, kernel, *expected);
+
+    MappedFile file(path);
+    MappedFrame<int, NUM_ROWS, NUM_COLS> frame(file, 0);
+    VectorSink<int> output;
+    lineBufferConvMapped<int, 3, 3, NUM_ROWS, NUM_COLS>(frame, kernel, output);
+
+    REQUIRE(output.pixels.size() == (size_t) OUT_ROWS*OUT_COLS);
+    int mismatches = 0;
+    for (int i = 0; i < OUT_ROWS; i++) {
+      for (int j = 0; j < OUT_COLS; j++) {
+        mismatches += output.pixels[i*OUT_COLS + j] != (*expected)(i, j);
+      }
+    }
+    REQUIRE(mismatches == 0);
+
+    // Released pages fault back in from the file if the frame is read again.
+    REQUIRE(frame(0, 0) == pixels[0]);
+    REQUIRE(frame(NUM_ROWS - 1, NUM_COLS - 1) == pixels.back());
+
+    remove(path.c_str());
+  }
+
+}
@@ -0,0 +1,166 @@
+#include "catch.hpp"
+
+#include "median.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  template<typename ElemType>
+  class MedianSink {
+  public:
+    vector<ElemType> samples;
+
+    void write(const ElemType value) {
+      samples.push_back(value);
+    }
+  };
+
+  // Noise over a few clustered levels, so windows see both many distinct
+  // values and many ties.
+  template<typename ElemType, int NumRows, int NumCols>
+  void noiseImage(const int maxValue, const unsigned seed, CircularFIFO<ElemType, NumRows*NumCols>& out) {
+    srand(seed);
+    for (int i = 0; i < NumRows*NumCols; i++) {
+      int v = rand() % 4 == 0 ? (rand() % 3)*(maxValue / 2) : rand() % (maxValue + 1);
+      out.write(v);
+    }
+  }
+
+  template<typename ElemType, int KernelSize, int NumRows, int NumCols>
+  void checkEnginesAgree(const int maxValue) {
+    const int NUM_OUT = (NumRows - 2*(KernelSize / 2))*(NumCols - 2*(KernelSize / 2));
+
+    for (unsigned seed = 1; seed <= 3; seed++) {
+      CircularFIFO<ElemType, NumRows*NumCols> naiveIn;
+      CircularFIFO<ElemType, NumRows*NumCols> networkIn;
+      CircularFIFO<ElemType, NumRows*NumCols> histogramIn;
+      noiseImage<ElemType, NumRows, NumCols>(maxValue, seed, naiveIn);
+      noiseImage<ElemType, NumRows, NumCols>(maxValue, seed, networkIn);
+      noiseImage<ElemType, NumRows, NumCols>(maxValue, seed, histogramIn);
+
+      MedianSink<ElemType> naive;
+      MedianSink<ElemType> network;
+      MedianSink<ElemType> histogram;
+      lineBufferMedianNaive<ElemType, KernelSize, NumRows, NumCols>(naiveIn, naive);
+      lineBufferMedianNetwork<ElemType, KernelSize, NumRows, NumCols>(networkIn, network);
+      lineBufferMedianHistogram<ElemType, KernelSize, NumRows, NumCols>(histogramIn, histogram);
+
+      REQUIRE(naive.samples.size() == NUM_OUT);
+      REQUIRE(network.samples == naive.samples);
+      REQUIRE(histogram.samples == naive.samples);
+    }
+  }
+
+  TEST_CASE("Median of a known 5x4 image") {
+    const int data[4][5] = {
+      {9, 1, 5, 7, 3},
+      {2, 8, 6, 0, 4},
+      {5, 5, 1, 9, 9},
+      {3, 7, 2, 8, 6}
+    };
+
+    CircularFIFO<uint8_t, 20> input;
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 5; j++) {
+        input.write(data[i][j]);
+      }
+    }
+
+    MedianSink<uint8_t> output;
+    lineBufferMedianHistogram<uint8_t, 3, 4, 5>(input, output);
+
+    const uint8_t expected[6] = {5, 5, 5, 5, 6, 6};
+    REQUIRE(output.samples == vector<uint8_t>(expected, expected + 6));
+  }
+
+  TEST_CASE("The 3x3 network selects the median of every 0-1 input") {
+    // A comparator network that selects correctly on all 0-1 inputs
+    // selects correctly on all inputs.
+    for (int bits = 0; bits < (1 << 9); bits++) {
+      int p[9];
+      int ones = 0;
+      for (int i = 0; i < 9; i++) {
+        p[i] = (bits >> i) & 1;
+        ones += p[i];
+      }
+      REQUIRE(MedianNetwork<3>::median(p) == (ones >= 5 ? 1 : 0));
+    }
+  }
+
+  TEST_CASE("The 5x5 network selects the median of random 0-1 inputs") {
+    srand(25);
+    for (int trial = 0; trial < 20000; trial++) {
+      int p[25];
+      int ones = 0;
+      for (int i = 0; i < 25; i++) {
+        p[i] = rand() & 1;
+        ones += p[i];
+      }
+      REQUIRE(MedianNetwork<5>::median(p) == (ones >= 13 ? 1 : 0));
+    }
+  }
+
+  TEST_CASE("Median network tables drop the padding") {
+    MedianNetworkTable nine(9);
+    REQUIRE(nine.comparators.size() < 63);
+
+    // The unrolled 5x5 network is this table; a full 32 input Batcher
+    // sort has 191 comparators.
+    MedianNetworkTable twentyFive(25);
+    REQUIRE(twentyFive.comparators.size() == 113);
+    REQUIRE(twentyFive.medianIndex == 12);
+    for (auto& c : twentyFive.comparators) {
+      REQUIRE(c.first < 25);
+      REQUIRE(c.second < 25);
+    }
+  }
+
+  TEST_CASE("Median engines agree on 8 bit noise") {
+    checkEnginesAgree<uint8_t, 3, 17, 23>(255);
+    checkEnginesAgree<uint8_t, 5, 17, 23>(255);
+    checkEnginesAgree<uint8_t, 7, 17, 23>(255);
+    checkEnginesAgree<uint8_t, 9, 20, 31>(255);
+  }
+
+  TEST_CASE("Median engines agree on 16 bit noise") {
+    checkEnginesAgree<uint16_t, 3, 17, 23>(65535);
+    checkEnginesAgree<uint16_t, 5, 17, 23>(4095);
+    checkEnginesAgree<uint16_t, 7, 17, 23>(1023);
+  }
+
+  TEST_CASE("Histogram median of a constant image") {
+    CircularFIFO<uint16_t, 16*16> input;
+    for (int i = 0; i < 16*16; i++) {
+      input.write(40000);
+    }
+
+    MedianSink<uint16_t> output;
+    lineBufferMedianHistogram<uint16_t, 11, 16, 16>(input, output);
+    REQUIRE(output.samples == vector<uint16_t>(6*6, 40000));
+  }
+
+  TEST_CASE("lineBufferMedian dispatches on the window size") {
+    CircularFIFO<uint8_t, 15*15> small;
+    CircularFIFO<uint8_t, 15*15> large;
+    CircularFIFO<uint8_t, 15*15> reference;
+    noiseImage<uint8_t, 15, 15>(255, 7, small);
+    noiseImage<uint8_t, 15, 15>(255, 7, large);
+
+    MedianSink<uint8_t> smallOut;
+    lineBufferMedian<uint8_t, 3, 15, 15>(small, smallOut);
+    REQUIRE(smallOut.samples.size() == 13*13);
+
+    MedianSink<uint8_t> largeOut;
+    lineBufferMedian<uint8_t, 13, 15, 15>(large, largeOut);
+
+    noiseImage<uint8_t, 15, 15>(255, 7, reference);
+    MedianSink<uint8_t> naiveOut;
+    lineBufferMedianNaive<uint8_t, 13, 15, 15>(reference, naiveOut);
+    REQUIRE(largeOut.samples == naiveOut.samples);
+  }
+
+}
@@ -0,0 +1,166 @@
+#include "catch.hpp"
+
+#include "morphology.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  template<typename ElemType>
+  class MorphSink {
+  public:
+    vector<ElemType> samples;
+
+    void write(const ElemType value) {
+      samples.push_back(value);
+    }
+  };
+
+  template<typename ElemType>
+  class VectorStream {
+
+    const vector<ElemType>& pixels;
+    size_t next;
+
+  public:
+
+    VectorStream(const vector<ElemType>& pixels_) : pixels(pixels_), next(0) {}
+
+    ElemType read() const {
+      return pixels[next];
+    }
+
+    void pop() {
+      next++;
+    }
+
+    bool isEmpty() const {
+      return next == pixels.size();
+    }
+  };
+
+  // Min or max over every window, clipped to the image.
+  template<typename ElemType, typename Op>
+  vector<ElemType> bruteForce(const vector<ElemType>& image, const int rows, const int cols,
+                              const int kernelRows, const int kernelCols) {
+    vector<ElemType> out(rows*cols);
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
+        ElemType v = Op::identity();
+        for (int di = -(kernelRows / 2); di <= kernelRows / 2; di++) {
+          for (int dj = -(kernelCols / 2); dj <= kernelCols / 2; dj++) {
+            if (i + di >= 0 && i + di < rows && j + dj >= 0 && j + dj < cols) {
+              v = Op::apply(v, image[(i + di)*cols + j + dj]);
+            }
+          }
+        }
+        out[i*cols + j] = v;
+      }
+    }
+    return out;
+  }
+
+  template<typename ElemType>
+  vector<ElemType> noise(const int n, const int maxValue, const unsigned seed) {
+    srand(seed);
+    vector<ElemType> image(n);
+    for (int i = 0; i < n; i++) {
+      image[i] = rand() % (maxValue + 1);
+    }
+    return image;
+  }
+
+  template<typename ElemType, int KR, int KC, int R, int C>
+  void checkAgainstBruteForce(const int maxValue) {
+    vector<ElemType> image = noise<ElemType>(R*C, maxValue, KR*100 + KC);
+
+    VectorStream<ElemType> erodeIn(image);
+    MorphSink<ElemType> eroded;
+    lineBufferErode<ElemType, KR, KC, R, C>(erodeIn, eroded);
+    vector<ElemType> expectedErode = bruteForce<ElemType, MorphMin<ElemType> >(image, R, C, KR, KC);
+    REQUIRE(eroded.samples == expectedErode);
+
+    VectorStream<ElemType> dilateIn(image);
+    MorphSink<ElemType> dilated;
+    lineBufferDilate<ElemType, KR, KC, R, C>(dilateIn, dilated);
+    vector<ElemType> expectedDilate = bruteForce<ElemType, MorphMax<ElemType> >(image, R, C, KR, KC);
+    REQUIRE(dilated.samples == expectedDilate);
+
+    VectorStream<ElemType> openIn(image);
+    MorphSink<ElemType> opened;
+    lineBufferOpen<ElemType, KR, KC, R, C>(openIn, opened);
+    REQUIRE(opened.samples == (bruteForce<ElemType, MorphMax<ElemType> >(expectedErode, R, C, KR, KC)));
+
+    VectorStream<ElemType> closeIn(image);
+    MorphSink<ElemType> closed;
+    lineBufferClose<ElemType, KR, KC, R, C>(closeIn, closed);
+    REQUIRE(closed.samples == (bruteForce<ElemType, MorphMin<ElemType> >(expectedDilate, R, C, KR, KC)));
+  }
+
+  TEST_CASE("Erosion and dilation match brute force") {
+    checkAgainstBruteForce<uint8_t, 3, 3, 12, 17>(255);
+    checkAgainstBruteForce<uint8_t, 5, 3, 12, 17>(255);
+    checkAgainstBruteForce<uint8_t, 1, 7, 12, 17>(255);
+    checkAgainstBruteForce<uint8_t, 7, 1, 12, 17>(255);
+    checkAgainstBruteForce<uint16_t, 9, 5, 23, 19>(4095);
+    checkAgainstBruteForce<int, 5, 5, 16, 16>(1000);
+  }
+
+  TEST_CASE("Structuring elements larger than the image") {
+    checkAgainstBruteForce<uint8_t, 11, 13, 6, 8>(255);
+  }
+
+  TEST_CASE("Opening removes specks smaller than the structuring element") {
+    const int R = 10;
+    const int C = 12;
+    vector<uint8_t> image(R*C, 10);
+    image[3*C + 4] = 200;
+    for (int i = 5; i < 9; i++) {
+      for (int j = 6; j < 10; j++) {
+        image[i*C + j] = 100;
+      }
+    }
+
+    VectorStream<uint8_t> input(image);
+    MorphSink<uint8_t> opened;
+    lineBufferOpen<uint8_t, 3, 3, R, C>(input, opened);
+
+    REQUIRE(opened.samples[3*C + 4] == 10);
+    REQUIRE(opened.samples[5*C + 6] == 100);
+    REQUIRE(opened.samples[8*C + 9] == 100);
+  }
+
+  TEST_CASE("Morphology rows can be reused for another image") {
+    MorphologyRows<int, 3, 3, 4, MorphMax<int> > rows;
+    vector<int> out;
+    auto collect = [&out](const int* row) {
+      out.insert(out.end(), row, row + 4);
+    };
+
+    for (int image = 0; image < 2; image++) {
+      out.clear();
+      for (int i = 0; i < 3; i++) {
+        int row[4] = {0, 0, 0, 0};
+        if (i == image) {
+          row[image] = 7;
+        }
+        rows.pushRow(row, collect);
+      }
+      rows.finish(collect);
+
+      vector<int> expected(12, 0);
+      for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+          if (abs(i - image) <= 1 && abs(j - image) <= 1) {
+            expected[i*4 + j] = 7;
+          }
+        }
+      }
+      REQUIRE(out == expected);
+    }
+  }
+
+}
@@ -0,0 +1,186 @@
+#include "catch.hpp"
+
+#include "example_vectors.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace swlb {
+
+  template<int KernelSize>
+  Mem2D<int, KernelSize, KernelSize> asymmetricKernel() {
+    Mem2D<int, KernelSize, KernelSize> kernel;
+    for (int i = 0; i < KernelSize; i++) {
+      for (int j = 0; j < KernelSize; j++) {
+        kernel.set(i, j, i - j);
+      }
+    }
+
+    return kernel;
+  }
+
+  template<int NumRows, int NumCols, int KernelSize>
+  void serialConv(const Mem2D<int, NumRows, NumCols>& input,
+                  const Mem2D<int, KernelSize, KernelSize>& kernel,
+                  Mem2D<int, NumRows - 2*(KernelSize / 2), NumCols - 2*(KernelSize / 2)>& output) {
+    const int OUT_ROWS = NumRows - 2*(KernelSize / 2);
+    const int OUT_COLS = NumCols - 2*(KernelSize / 2);
+
+    CircularFIFO<int, NumRows*NumCols> inputBuf;
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        inputBuf.write(input(i, j));
+      }
+    }
+
+    CircularFIFO<int, OUT_ROWS*OUT_COLS> serialOutput;
+    lineBufferConv<int, KernelSize, KernelSize, NumRows, NumCols>(inputBuf, kernel, serialOutput);
+
+    for (int i = 0; i < OUT_ROWS; i++) {
+      for (int j = 0; j < OUT_COLS; j++) {
+        output.set(i, j, serialOutput.read());
+        serialOutput.pop();
+      }
+    }
+  }
+
+  template<int NumRows, int NumCols>
+  bool sameImage(const Mem2D<int, NumRows, NumCols>& a,
+                 const Mem2D<int, NumRows, NumCols>& b) {
+    for (int i = 0; i < NumRows; i++) {
+      for (int j = 0; j < NumCols; j++) {
+        if (a(i, j) != b(i, j)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  template<int NumRows, int NumCols, int KernelSize>
+  void checkParallelMatchesSerial(const int numThreads, const int numStrips) {
+    const int OUT_ROWS = NumRows - 2*(KernelSize / 2);
+    const int OUT_COLS = NumCols - 2*(KernelSize / 2);
+
+    Mem2D<int, NumRows, NumCols> input = sequentialImage<NumRows, NumCols>();
+    Mem2D<int, KernelSize, KernelSize> kernel = asymmetricKernel<KernelSize>();
+
+    Mem2D<int, OUT_ROWS, OUT_COLS> serialOutput;
+    serialConv(input, kernel, serialOutput);
+
+    ThreadPool pool(numThreads);
+    Mem2D<int, OUT_ROWS, OUT_COLS> parallelOutput;
+    lineBufferConvParallel(input, kernel, parallelOutput, pool, numStrips);
+
+    REQUIRE(sameImage(parallelOutput, serialOutput));
+  }
+
+  template<int TileCols, int NumRows, int NumCols, int KernelSize>
+  void checkTiledMatchesSerial(const int numThreads, const int tileRows) {
+    const int OUT_ROWS = NumRows - 2*(KernelSize / 2);
+    const int OUT_COLS = NumCols - 2*(KernelSize / 2);
+
+    Mem2D<int, NumRows, NumCols> input = sequentialImage<NumRows, NumCols>();
+    Mem2D<int, KernelSize, KernelSize> kernel = asymmetricKernel<KernelSize>();
+
+    Mem2D<int, OUT_ROWS, OUT_COLS> serialOutput;
+    serialConv(input, kernel, serialOutput);
+
+    ThreadPool pool(numThreads);
+    Mem2D<int, OUT_ROWS, OUT_COLS> tiledOutput;
+    lineBufferConvTiled<TileCols>(input, kernel, tiledOutput, pool, tileRows);
+
+    REQUIRE(sameImage(tiledOutput, serialOutput));
+  }
+
+  TEST_CASE("Strip parallel convolution with one thread matches serial") {
+    checkParallelMatchesSerial<8, 10, 3>(1, 0);
+  }
+
+  TEST_CASE("Strip parallel convolution with several threads matches serial") {
+    checkParallelMatchesSerial<8, 10, 3>(3, 0);
+    checkParallelMatchesSerial<40, 17, 3>(4, 0);
+    checkParallelMatchesSerial<40, 17, 5>(4, 7);
+  }
+
+  TEST_CASE("Strip parallel convolution with more strips than rows matches serial") {
+    checkParallelMatchesSerial<12, 9, 5>(2, 50);
+  }
+
+  TEST_CASE("Strip heights keep strip boundaries on cache lines") {
+    REQUIRE((stripRowGranularity<int, 16>()) == 1);
+    REQUIRE((stripRowGranularity<int, 8>()) == 2);
+    REQUIRE((stripRowGranularity<char, 10>()) == 32);
+  }
+
+  TEST_CASE("Tiled convolution with tiles that divide the output matches serial") {
+    checkTiledMatchesSerial<4, 10, 10, 3>(2, 4);
+  }
+
+  TEST_CASE("Tiled convolution with partial edge tiles matches serial") {
+    checkTiledMatchesSerial<8, 37, 29, 3>(3, 5);
+    checkTiledMatchesSerial<4, 23, 31, 5>(4, 3);
+    checkTiledMatchesSerial<16, 9, 11, 3>(2, 100);
+  }
+
+  TEST_CASE("Tiled convolution with planned tile size matches serial") {
+    const int NROWS = 20;
+    const int NCOLS = 300;
+
+    Mem2D<int, NROWS, NCOLS> input = sequentialImage<NROWS, NCOLS>();
+    Mem2D<int, 3, 3> kernel = asymmetricKernel<3>();
+
+    Mem2D<int, NROWS - 2, NCOLS - 2> serialOutput;
+    serialConv(input, kernel, serialOutput);
+
+    ThreadPool pool(3);
+    Mem2D<int, NROWS - 2, NCOLS - 2> tiledOutput;
+    lineBufferConvTiled(input, kernel, tiledOutput, pool, 7, StripPlanner(512));
+
+    REQUIRE(sameImage(tiledOutput, serialOutput));
+  }
+
+  TEST_CASE("Cache sized tiles keep the line buffer inside the budget") {
+    const int tileCols = cacheTileCols(sizeof(int), 5, 5, 64*1024);
+    REQUIRE(tileWorkingSetBytes(sizeof(int), 5, 5, tileCols) <= 64*1024);
+    REQUIRE(tileWorkingSetBytes(sizeof(int), 5, 5, 2*tileCols) > 64*1024);
+    REQUIRE(cacheTileCols(sizeof(int), 3, 3, 16) == 8);
+  }
+
+  TEST_CASE("Work stealing pool runs every submitted task") {
+    ThreadPool pool(4);
+    vector<int> done(1000, 0);
+    for (int i = 0; i < 1000; i++) {
+      pool.submit([&done, i]() { done[i]++; });
+    }
+    pool.wait();
+
+    for (int i = 0; i < 1000; i++) {
+      REQUIRE(done[i] == 1);
+    }
+  }
+
+  TEST_CASE("Strip executor splits columns when the planner budget is small") {
+    const int NROWS = 30;
+    const int NCOLS = 200;
+
+    Mem2D<int, NROWS, NCOLS> input = sequentialImage<NROWS, NCOLS>();
+    Mem2D<int, 5, 5> kernel = asymmetricKernel<5>();
+
+    Mem2D<int, NROWS - 4, NCOLS - 4> serialOutput;
+    serialConv(input, kernel, serialOutput);
+
+    StripPlanner planner(1024);
+    REQUIRE(planner.stripCols(sizeof(int), 5, 5, NCOLS - 4) < NCOLS - 4);
+
+    ThreadPool pool(3);
+    Mem2D<int, NROWS - 4, NCOLS - 4> parallelOutput;
+    lineBufferConvParallel(input, kernel, parallelOutput, pool, 0, planner);
+    REQUIRE(sameImage(parallelOutput, serialOutput));
+
+    Mem2D<int, NROWS - 4, NCOLS - 4> tiledOutput;
+    lineBufferConvTiled(input, kernel, tiledOutput, pool, 6, planner);
+    REQUIRE(sameImage(tiledOutput, serialOutput));
+  }
+
+}
@@ -0,0 +1,291 @@
+#include "catch.hpp"
+
+#include "pnm.h"
+#include "temp_path.h"
+
+#include <cstdint>
+
+using namespace std;
+
+namespace swlb {
+
+  static void writeFileBytes(const string& path, const string& bytes) {
+    FILE* f = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), f);
+    fclose(f);
+  }
+
+  TEST_CASE("8 bit PGM round trip") {
+    const int rows = 5;
+    const int cols = 7;
+    string path = tempTestPath("8bit.pgm");
+
+    {
+      PnmWriter writer(path, cols, rows, 1, 255);
+      REQUIRE(writer.isValid());
+      for (int i = 0; i < rows; i++) {
+        vector<int> row(cols);
+        for (int j = 0; j < cols; j++) {
+          row[j] = 40*i + j;
+        }
+        REQUIRE(writer.writeRow(row.data()));
+      }
+      REQUIRE(writer.close());
+    }
+
+    PnmReader reader(path);
+    REQUIRE(reader.isValid());
+    REQUIRE(reader.rows() == rows);
+    REQUIRE(reader.cols() == cols);
+    REQUIRE(reader.channels() == 1);
+    REQUIRE(reader.bytesPerSample() == 1);
+
+    for (int i = 0; i < rows; i++) {
+      vector<int> row(cols);
+      REQUIRE(reader.readRow(row.data()));
+      for (int j = 0; j < cols; j++) {
+        REQUIRE(row[j] == 40*i + j);
+      }
+    }
+
+    REQUIRE(reader.done());
+    REQUIRE(!reader.readRow((int*) nullptr));
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("16 bit PGM round trip is big endian and clamps") {
+    const int cols = 4;
+    string path = tempTestPath("16bit.pgm");
+
+    {
+      PnmWriter writer(path, cols, 1, 1, 65535);
+      REQUIRE(writer.bytesPerSample() == 2);
+      int row[cols] = {0x1234, 65535, -5, 70000};
+      REQUIRE(writer.writeRow(row));
+      REQUIRE(writer.close());
+    }
+
+    FILE* f = fopen(path.c_str(), "rb");
+    string header = "P5\n4 1\n65535\n";
+    vector<unsigned char> bytes(header.size() + 2*cols);
+    REQUIRE(fread(bytes.data(), 1, bytes.size(), f) == bytes.size());
+    fclose(f);
+    REQUIRE(bytes[header.size()] == 0x12);
+    REQUIRE(bytes[header.size() + 1] == 0x34);
+
+    PnmReader reader(path);
+    int row[cols];
+    REQUIRE(reader.readRow(row));
+    REQUIRE(row[0] == 0x1234);
+    REQUIRE(row[1] == 65535);
+    REQUIRE(row[2] == 0);
+    REQUIRE(row[3] == 65535);
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("PPM rows are interleaved RGB") {
+    string path = tempTestPath("rgb.ppm");
+
+    {
+      PnmWriter writer(path, 2, 1, 3, 255);
+      int row[6] = {1, 2, 3, 4, 5, 6};
+      REQUIRE(writer.writeRow(row));
+      REQUIRE(writer.close());
+    }
+
+    PnmReader reader(path);
+    REQUIRE(reader.isValid());
+    REQUIRE(reader.channels() == 3);
+    REQUIRE(reader.rowSamples() == 6);
+
+    int row[6];
+    REQUIRE(reader.readRow(row));
+    for (int i = 0; i < 6; i++) {
+      REQUIRE(row[i] == i + 1);
+    }
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("PNM header comments are skipped") {
+    string path = tempTestPath("comments.pgm");
+    writeFileBytes(path, string("P5\n# made by hand\n3 # cols\n1\n255\n") + "\x01\x02\x03");
+
+    PnmReader reader(path);
+    REQUIRE(reader.isValid());
+    REQUIRE(reader.cols() == 3);
+    REQUIRE(reader.rows() == 1);
+
+    int row[3];
+    REQUIRE(reader.readRow(row));
+    REQUIRE(row[0] == 1);
+    REQUIRE(row[2] == 3);
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("Malformed or truncated PNM files are rejected") {
+    string path = tempTestPath("bad.pgm");
+
+    writeFileBytes(path, "P2\n3 1\n255\n1 2 3\n");
+    REQUIRE(!PnmReader(path).isValid());
+
+    writeFileBytes(path, string("P5\n3 2\n255\n") + "\x01\x02\x03\x04");
+    PnmReader reader(path);
+    REQUIRE(reader.isValid());
+    int row[3];
+    REQUIRE(reader.readRow(row));
+    REQUIRE(!reader.readRow(row));
+    REQUIRE(!reader.isValid());
+
+    REQUIRE(!PnmReader(tempTestPath("missing.pgm")).isValid());
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("PGM file convolution matches lineBufferConv") {
+    const int NUM_ROWS = 12;
+    const int NUM_COLS = 17;
+    const int OUT_ROWS = NUM_ROWS - 2;
+    const int OUT_COLS = NUM_COLS - 2;
+
+    string inPath = tempTestPath("conv-in.pgm");
+    string outPath = tempTestPath("conv-out.pgm");
+
+    CircularFIFO<int, NUM_ROWS*NUM_COLS> fifo;
+    {
+      PnmWriter writer(inPath, NUM_COLS, NUM_ROWS, 1, 65535);
+      for (int i = 0; i < NUM_ROWS; i++) {
+        vector<int> row(NUM_COLS);
+        for (int j = 0; j < NUM_COLS; j++) {
+          row[j] = (i*NUM_COLS + j)*97 % 1000;
+          fifo.write(row[j]);
+        }
+        writer.writeRow(row.data());
+      }
+      REQUIRE(writer.close());
+    }
+
+    Mem2D<int, 3, 3> kernel;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        kernel.set(i, j, i + j);
+      }
+    }
+
+    CircularFIFO<int, OUT_ROWS*OUT_COLS> expected;
+    lineBufferConv<int, 3, 3, NUM_ROWS, NUM_COLS>(fifo, kernel, expected);
+
+    {
+      PnmReader reader(inPath);
+      PnmWriter writer(outPath, OUT_COLS, OUT_ROWS, 1, 65535);
+      REQUIRE((lineBufferConvPnm<int, 3, 3, NUM_ROWS, NUM_COLS>(reader, kernel, writer)));
+      REQUIRE(writer.close());
+    }
+
+    PnmReader result(outPath);
+    REQUIRE(result.rows() == OUT_ROWS);
+    REQUIRE(result.cols() == OUT_COLS);
+    for (int i = 0; i < OUT_ROWS; i++) {
+      vector<int> row(OUT_COLS);
+      REQUIRE(result.readRow(row.data()));
+      for (int j = 0; j < OUT_COLS; j++) {
+        REQUIRE(row[j] == expected.read());
+        expected.pop();
+      }
+    }
+
+    {
+      PnmReader reader(inPath);
+      PnmWriter writer(outPath, OUT_COLS + 1, OUT_ROWS, 1, 65535);
+      REQUIRE(!(lineBufferConvPnm<int, 3, 3, NUM_ROWS, NUM_COLS>(reader, kernel, writer)));
+    }
+
+    remove(inPath.c_str());
+    remove(outPath.c_str());
+  }
+
+  // A horizontal ramp up and back down through a gradient kernel gives
+  // sums far above maxVal on the way up and far below 0 on the way down,
+  // out of range for ElemType too. They must reach the file clamped, not
+  // wrapped to ElemType first.
+  template<typename ElemType>
+  void checkNarrowConvClamps(const int maxVal, const int scale, const string& name) {
+    const int NUM_ROWS = 5;
+    const int NUM_COLS = 9;
+    const int OUT_ROWS = NUM_ROWS - 2;
+    const int OUT_COLS = NUM_COLS - 2;
+    const int ramp[NUM_COLS] = {0, 1, 2, 3, 4, 3, 2, 1, 0};
+
+    string inPath = tempTestPath(name + "-in.pgm");
+    string outPath = tempTestPath(name + "-out.pgm");
+
+    CircularFIFO<int, NUM_ROWS*NUM_COLS> fifo;
+    {
+      PnmWriter writer(inPath, NUM_COLS, NUM_ROWS, 1, maxVal);
+      for (int i = 0; i < NUM_ROWS; i++) {
+        vector<int> row(NUM_COLS);
+        for (int j = 0; j < NUM_COLS; j++) {
+          row[j] = ramp[j]*scale;
+          fifo.write(row[j]);
+        }
+        writer.writeRow(row.data());
+      }
+      REQUIRE(writer.close());
+    }
+
+    Mem2D<int, 3, 3> intKernel;
+    Mem2D<ElemType, 3, 3> kernel;
+    for (int i = 0; i < 3; i++) {
+      intKernel.set(i, 0, -3);
+      intKernel.set(i, 2, 3);
+      kernel.set(i, 0, -3);
+      kernel.set(i, 2, 3);
+    }
+
+    CircularFIFO<int, OUT_ROWS*OUT_COLS> sums;
+    lineBufferConv<int, 3, 3, NUM_ROWS, NUM_COLS>(fifo, intKernel, sums);
+
+    {
+      PnmReader reader(inPath);
+      PnmWriter writer(outPath, OUT_COLS, OUT_ROWS, 1, maxVal);
+      REQUIRE((lineBufferConvPnm<ElemType, 3, 3, NUM_ROWS, NUM_COLS>(reader, kernel, writer)));
+      REQUIRE(writer.close());
+    }
+
+    PnmReader result(outPath);
+    int clampedHigh = 0;
+    int clampedLow = 0;
+    for (int i = 0; i < OUT_ROWS; i++) {
+      vector<int> row(OUT_COLS);
+      REQUIRE(result.readRow(row.data()));
+      for (int j = 0; j < OUT_COLS; j++) {
+        const int sum = sums.read();
+        sums.pop();
+        if (sum > maxVal) {
+          REQUIRE(row[j] == maxVal);
+          clampedHigh++;
+        } else if (sum < 0) {
+          REQUIRE(row[j] == 0);
+          clampedLow++;
+        } else {
+          REQUIRE(row[j] == sum);
+        }
+      }
+    }
+    REQUIRE(clampedHigh > 0);
+    REQUIRE(clampedLow > 0);
+
+    remove(inPath.c_str());
+    remove(outPath.c_str());
+  }
+
+  TEST_CASE("Narrow element type convolution clamps instead of wrapping") {
+    // Sums of +-540 against 255, and +-135000 against 65535.
+    checkNarrowConvClamps<int8_t>(255, 30, "narrow8");
+    checkNarrowConvClamps<int16_t>(65535, 7500, "narrow16");
+  }
+
+}
@@ -0,0 +1,108 @@
+#include "catch.hpp"
+
+#include "raw_packed.h"
+
+#include <vector>
+
+using namespace std;
+
+namespace swlb {
+
+  TEST_CASE("RAW10 groups follow the MIPI layout") {
+    const uint8_t bytes[5] = {0x12, 0x34, 0x56, 0x78, 0xe4};
+    int pixels[4];
+    unpackGroup(PACKED_RAW10, bytes, pixels);
+
+    REQUIRE(pixels[0] == ((0x12 << 2) | 0));
+    REQUIRE(pixels[1] == ((0x34 << 2) | 1));
+    REQUIRE(pixels[2] == ((0x56 << 2) | 2));
+    REQUIRE(pixels[3] == ((0x78 << 2) | 3));
+
+    uint8_t repacked[5];
+    packGroup(PACKED_RAW10, pixels, repacked);
+    for (int i = 0; i < 5; i++) {
+      REQUIRE(repacked[i] == bytes[i]);
+    }
+  }
+
+  TEST_CASE("RAW12 groups follow the MIPI layout") {
+    const uint8_t bytes[3] = {0xab, 0xcd, 0x9f};
+    int pixels[2];
+    unpackGroup(PACKED_RAW12, bytes, pixels);
+
+    REQUIRE(pixels[0] == 0xabf);
+    REQUIRE(pixels[1] == 0xcd9);
+
+    uint8_t repacked[3];
+    packGroup(PACKED_RAW12, pixels, repacked);
+    for (int i = 0; i < 3; i++) {
+      REQUIRE(repacked[i] == bytes[i]);
+    }
+  }
+
+  TEST_CASE("Packed rows round trip including a partial last group") {
+    PackedFormat formats[2] = {PACKED_RAW10, PACKED_RAW12};
+    for (PackedFormat f : formats) {
+      const int cols = 11;
+      const int maxVal = f == PACKED_RAW10 ? 1023 : 4095;
+      REQUIRE(packedRowBytes(f, cols) == (f == PACKED_RAW10 ? 15 : 18));
+
+      vector<int> row(cols);
+      for (int j = 0; j < cols; j++) {
+        row[j] = (j*397 + 11) % (maxVal + 1);
+      }
+
+      vector<uint8_t> bytes(packedRowBytes(f, cols));
+      packRow(f, row.data(), cols, bytes.data());
+
+      vector<int> unpacked(cols);
+      unpackRow(f, bytes.data(), cols, unpacked.data());
+      REQUIRE(unpacked == row);
+    }
+  }
+
+  TEST_CASE("Convolving a packed frame matches lineBufferConv on the unpacked frame") {
+    const int NROWS = 9;
+    const int NCOLS = 13;
+    const int OUT_ROWS = NROWS - 2;
+    const int OUT_COLS = NCOLS - 2;
+
+    Mem2D<int, 3, 3> kernel;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        kernel.set(i, j, i - j + 1);
+      }
+    }
+
+    PackedFormat formats[2] = {PACKED_RAW10, PACKED_RAW12};
+    for (PackedFormat f : formats) {
+      // Padded rows, as capture hardware often aligns the stride.
+      const long stride = packedRowBytes(f, NCOLS) + 7;
+      const int maxVal = f == PACKED_RAW10 ? 1023 : 4095;
+
+      vector<uint8_t> frame(NROWS*stride, 0xff);
+      CircularFIFO<int, NROWS*NCOLS> unpacked;
+      for (int i = 0; i < NROWS; i++) {
+        vector<int> row(NCOLS);
+        for (int j = 0; j < NCOLS; j++) {
+          row[j] = (i*NCOLS*31 + j*17) % (maxVal + 1);
+          unpacked.write(row[j]);
+        }
+        packRow(f, row.data(), NCOLS, frame.data() + i*stride);
+      }
+
+      CircularFIFO<int, OUT_ROWS*OUT_COLS> expected;
+      lineBufferConv<int, 3, 3, NROWS, NCOLS>(unpacked, kernel, expected);
+
+      CircularFIFO<int, OUT_ROWS*OUT_COLS> output;
+      lineBufferConvPacked<int, 3, 3, NROWS, NCOLS>(frame.data(), f, stride, kernel, output);
+
+      for (int i = 0; i < OUT_ROWS*OUT_COLS; i++) {
+        REQUIRE(output.read() == expected.read());
+        output.pop();
+        expected.pop();
+      }
+    }
+  }
+
+}
@@ -0,0 +1,51 @@
+#include "catch.hpp"
+
+#include "conv_check.h"
+#include "example_vectors.h"
+#include "static_kernel.h"
+
+using namespace std;
+
+namespace swlb {
+
+  static_assert(tapKind(0) == TAP_ZERO, "zero taps are dropped");
+  static_assert(tapKind(1) == TAP_ADD, "+1 is an add");
+  static_assert(tapKind(-1) == TAP_SUBTRACT, "-1 is a subtract");
+  static_assert(tapKind(4) == TAP_SHIFT_ADD && tapShift(4) == 2, "4 is a shift by 2");
+  static_assert(tapKind(-16) == TAP_SHIFT_SUBTRACT && tapShift(16) == 4, "-16 is a subtracted shift");
+  static_assert(tapKind(6) == TAP_MULTIPLY, "6 is a multiply");
+  static_assert(tapKind(-3) == TAP_MULTIPLY, "-3 is a multiply");
+
+  // Signed samples, so the shifted taps see negative values too.
+  template<typename Kernel>
+  void checkMatchesRuntimeKernel() {
+    const int SROWS = 9;
+    const int SCOLS = 13;
+
+    Mem2D<int, SROWS, SCOLS> input = patternedImage<SROWS, SCOLS>();
+    CircularFIFO<int, SROWS*SCOLS> in;
+    fill(in, input);
+
+    CircularFIFO<int, (SROWS - 2*(Kernel::ROWS / 2))*(SCOLS - 2*(Kernel::COLS / 2))> out;
+    lineBufferConvStatic<Kernel, SROWS, SCOLS>(in, out);
+
+    requireMatchesBulk(input, Kernel::template toMem2D<int>(), out);
+  }
+
+  TEST_CASE("Fixed kernels match their runtime Mem2D versions") {
+    checkMatchesRuntimeKernel<SobelXKernel>();
+    checkMatchesRuntimeKernel<SobelYKernel>();
+    checkMatchesRuntimeKernel<LaplacianKernel>();
+    checkMatchesRuntimeKernel<Binomial3Kernel>();
+    checkMatchesRuntimeKernel<Binomial5Kernel>();
+  }
+
+  TEST_CASE("Static kernels with every kind of tap and a rectangular shape") {
+    typedef StaticKernel<3, 5,
+                         3, 0, -8, 1, -1,
+                         0, 7, 2, -5, 0,
+                         -1, 64, 0, -2, 9> Mixed;
+    checkMatchesRuntimeKernel<Mixed>();
+  }
+
+}
@@ -0,0 +1,65 @@
+#include "catch.hpp"
+
+#include "conv_check.h"
+#include "example_vectors.h"
+#include "symmetric.h"
+
+using namespace std;
+
+namespace swlb {
+
+  template<int KR, int KC>
+  Mem2D<int, KR, KC> mirroredKernel(const int symmetry) {
+    Mem2D<int, KR, KC> kernel;
+    for (int r = 0; r < KR; r++) {
+      for (int c = 0; c < KC; c++) {
+        const int rr = (symmetry & SYMMETRY_VERTICAL) ? min(r, KR - 1 - r) : r;
+        const int cc = (symmetry & SYMMETRY_HORIZONTAL) ? min(c, KC - 1 - c) : c;
+        kernel.set(r, c, rr*7 - cc*3 + 2);
+      }
+    }
+    return kernel;
+  }
+
+  // Folded results against bulkConv, with the symmetry either declared or
+  // detected.
+  template<int KR, int KC>
+  void checkFoldedMatchesBulk(const Mem2D<int, KR, KC>& kernel, const bool declared) {
+    const int SROWS = 11;
+    const int SCOLS = 14;
+
+    Mem2D<int, SROWS, SCOLS> input = patternedImage<SROWS, SCOLS>();
+    CircularFIFO<int, SROWS*SCOLS> in;
+    fill(in, input);
+
+    CircularFIFO<int, (SROWS - 2*(KR / 2))*(SCOLS - 2*(KC / 2))> out;
+    if (declared) {
+      lineBufferConvSymmetric<int, KR, KC, SROWS, SCOLS>(in, kernel, out, kernelSymmetry(kernel));
+    } else {
+      lineBufferConvSymmetric<int, KR, KC, SROWS, SCOLS>(in, kernel, out);
+    }
+
+    requireMatchesBulk(input, kernel, out);
+  }
+
+  TEST_CASE("Kernel symmetries are detected") {
+    REQUIRE(kernelSymmetry(mirroredKernel<5, 5>(SYMMETRY_NONE)) == SYMMETRY_NONE);
+    REQUIRE(kernelSymmetry(mirroredKernel<5, 5>(SYMMETRY_HORIZONTAL)) == SYMMETRY_HORIZONTAL);
+    REQUIRE(kernelSymmetry(mirroredKernel<5, 5>(SYMMETRY_VERTICAL)) == SYMMETRY_VERTICAL);
+    REQUIRE(kernelSymmetry(mirroredKernel<3, 5>(SYMMETRY_BOTH)) == SYMMETRY_BOTH);
+
+    Mem2D<int, 3, 3> flat;
+    REQUIRE(kernelSymmetry(flat) == SYMMETRY_BOTH);
+  }
+
+  TEST_CASE("Folded convolution is bit exact with bulkConv") {
+    const int symmetries[] = {SYMMETRY_NONE, SYMMETRY_HORIZONTAL, SYMMETRY_VERTICAL, SYMMETRY_BOTH};
+    for (const int s : symmetries) {
+      checkFoldedMatchesBulk(mirroredKernel<3, 3>(s), true);
+      checkFoldedMatchesBulk(mirroredKernel<5, 5>(s), false);
+      checkFoldedMatchesBulk(mirroredKernel<3, 7>(s), true);
+      checkFoldedMatchesBulk(mirroredKernel<5, 1>(s), false);
+    }
+  }
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace swlb {
+
+  // A path under $TMPDIR, or /tmp, for a scratch file of the tests. The
+  // process id keeps concurrent test runs apart.
+  inline
+  string tempTestPath(const string& name) {
+    const char* dir = getenv("TMPDIR");
+    return string(dir != nullptr ? dir : "/tmp") + "/swlb-test-" + to_string(getpid()) + "-" + name;
+  }
+
+}
@@ -0,0 +1,273 @@
+#include "catch.hpp"
+
+#include "temp_path.h"
+#include "y4m.h"
+
+#include <cstdint>
+
+using namespace std;
+
+namespace swlb {
+
+  static int videoSample(const int frame, const int plane, const int i, const int j) {
+    return (frame*37 + plane*71 + i*13 + j*5) % 200 + 20;
+  }
+
+  static void writeTestVideo(const string& path, const VideoFormat& fmt, const int numFrames) {
+    Y4mWriter writer(path, fmt);
+    for (int f = 0; f < numFrames; f++) {
+      writer.beginFrame();
+      for (int p = 0; p < fmt.planes(); p++) {
+        vector<int> row(fmt.cols(p));
+        for (int i = 0; i < fmt.rows(p); i++) {
+          for (int j = 0; j < fmt.cols(p); j++) {
+            row[j] = videoSample(f, p, i, j);
+          }
+          writer.writeRow(p, row.data());
+        }
+      }
+    }
+    writer.flush();
+  }
+
+  TEST_CASE("Y4M colorspace tags") {
+    VideoFormat fmt;
+    REQUIRE(fmt.parseColorspaceTag("420jpeg"));
+    REQUIRE(fmt.chroma == CHROMA_420);
+    REQUIRE(fmt.bitDepth == 8);
+    REQUIRE(fmt.colorspaceTag() == "420jpeg");
+
+    REQUIRE(fmt.parseColorspaceTag("422p10"));
+    REQUIRE(fmt.chroma == CHROMA_422);
+    REQUIRE(fmt.bitDepth == 10);
+    REQUIRE(fmt.colorspaceTag() == "422p10");
+
+    REQUIRE(fmt.parseColorspaceTag("mono16"));
+    REQUIRE(fmt.chroma == CHROMA_MONO);
+    REQUIRE(fmt.bitDepth == 16);
+    REQUIRE(fmt.colorspaceTag() == "mono16");
+
+    REQUIRE(!fmt.parseColorspaceTag("411"));
+  }
+
+  TEST_CASE("Plane geometry follows chroma subsampling") {
+    VideoFormat fmt(1921, 1081, CHROMA_420);
+    REQUIRE(fmt.planes() == 3);
+    REQUIRE(fmt.rows(1) == 541);
+    REQUIRE(fmt.cols(2) == 961);
+    REQUIRE(fmt.frameBytes() == 1921L*1081 + 2L*541*961);
+
+    REQUIRE(VideoFormat(64, 32, CHROMA_422).rows(1) == 32);
+    REQUIRE(VideoFormat(64, 32, CHROMA_422).cols(1) == 32);
+    REQUIRE(VideoFormat(64, 32, CHROMA_MONO, 10).frameBytes() == 64*32*2);
+  }
+
+  TEST_CASE("Y4M round trip") {
+    string path = tempTestPath("roundtrip.y4m");
+    VideoFormat fmt(10, 6, CHROMA_420);
+    fmt.fpsNum = 60;
+    writeTestVideo(path, fmt, 3);
+
+    Y4mReader reader(path);
+    REQUIRE(reader.isValid());
+    REQUIRE(reader.format().width == 10);
+    REQUIRE(reader.format().height == 6);
+    REQUIRE(reader.format().chroma == CHROMA_420);
+    REQUIRE(reader.format().fpsNum == 60);
+
+    int frames = 0;
+    while (reader.nextFrame()) {
+      for (int p = 0; p < 3; p++) {
+        vector<int> row(fmt.cols(p));
+        for (int i = 0; i < fmt.rows(p); i++) {
+          REQUIRE(reader.readRow(p, row.data()));
+          for (int j = 0; j < fmt.cols(p); j++) {
+            REQUIRE(row[j] == videoSample(frames, p, i, j));
+          }
+        }
+      }
+      frames++;
+    }
+    REQUIRE(frames == 3);
+    REQUIRE(reader.isValid());
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("High bit depth Y4M samples are little endian") {
+    string path = tempTestPath("10bit.y4m");
+    {
+      Y4mWriter writer(path, VideoFormat(2, 1, CHROMA_MONO, 10));
+      writer.beginFrame();
+      int row[2] = {0x2a5, 5000};
+      writer.writeRow(0, row);
+      writer.flush();
+    }
+
+    FILE* f = fopen(path.c_str(), "rb");
+    string bytes(200, '\0');
+    bytes.resize(fread(&bytes[0], 1, bytes.size(), f));
+    fclose(f);
+    REQUIRE(bytes.substr(0, 10) == "YUV4MPEG2 ");
+    REQUIRE(bytes.find("Cmono10") != string::npos);
+    REQUIRE(bytes.substr(bytes.size() - 4) == string("\xa5\x02\xff\x03", 4));
+
+    Y4mReader reader(path);
+    REQUIRE(reader.format().bitDepth == 10);
+    REQUIRE(reader.nextFrame());
+    int row[2];
+    REQUIRE(reader.readRow(0, row));
+    REQUIRE(row[0] == 0x2a5);
+    REQUIRE(row[1] == 1023);
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("Raw YUV is read until the stream ends") {
+    string path = tempTestPath("frames.yuv");
+    VideoFormat fmt(4, 4, CHROMA_444);
+    {
+      FILE* f = fopen(path.c_str(), "wb");
+      for (int i = 0; i < 2*fmt.frameBytes(); i++) {
+        fputc(i % 251, f);
+      }
+      fclose(f);
+    }
+
+    RawYuvReader reader(path, fmt);
+    int frames = 0;
+    int expected = 0;
+    while (reader.nextFrame()) {
+      for (int p = 0; p < 3; p++) {
+        for (int i = 0; i < 4; i++) {
+          int row[4];
+          REQUIRE(reader.readRow(p, row));
+          for (int j = 0; j < 4; j++) {
+            REQUIRE(row[j] == expected % 251);
+            expected++;
+          }
+        }
+      }
+      frames++;
+    }
+    REQUIRE(frames == 2);
+
+    remove(path.c_str());
+  }
+
+  TEST_CASE("Video pipeline convolves every plane of every frame") {
+    const int NUM_ROWS = 8;
+    const int NUM_COLS = 12;
+    const int NUM_FRAMES = 3;
+    string inPath = tempTestPath("pipeline-in.y4m");
+    string outPath = tempTestPath("pipeline-out.y4m");
+
+    VideoFormat fmt(NUM_COLS, NUM_ROWS, CHROMA_420);
+    writeTestVideo(inPath, fmt, NUM_FRAMES);
+
+    // The writer clamps results to 8 bits, so the expected values do too.
+    Mem2D<int, 3, 3> kernel;
+    kernel.set(1, 1, 2);
+    kernel.set(0, 1, -1);
+    kernel.set(1, 2, 1);
+
+    {
+      Y4mReader reader(inPath);
+      Y4mWriter writer(outPath, reader.format());
+      VideoConvPipeline<int, 3, 3, NUM_ROWS, NUM_COLS, CHROMA_420> pipeline(kernel);
+      REQUIRE(pipeline.run(reader, writer) == NUM_FRAMES);
+    }
+
+    Y4mReader result(outPath);
+    REQUIRE(result.isValid());
+    REQUIRE(result.format().width == NUM_COLS);
+    REQUIRE(result.format().height == NUM_ROWS);
+
+    for (int f = 0; f < NUM_FRAMES; f++) {
+      REQUIRE(result.nextFrame());
+      for (int p = 0; p < 3; p++) {
+        const int rows = fmt.rows(p);
+        const int cols = fmt.cols(p);
+        for (int i = 0; i < rows; i++) {
+          vector<int> row(cols);
+          REQUIRE(result.readRow(p, row.data()));
+          for (int j = 0; j < cols; j++) {
+            // Margins replicate the nearest pixel of the valid region.
+            int ci = i < 1 ? 1 : (i > rows - 2 ? rows - 2 : i);
+            int cj = j < 1 ? 1 : (j > cols - 2 ? cols - 2 : j);
+            int expected = 2*videoSample(f, p, ci, cj) - videoSample(f, p, ci - 1, cj) + videoSample(f, p, ci, cj + 1);
+            expected = expected < 0 ? 0 : (expected > 255 ? 255 : expected);
+            REQUIRE(row[j] == expected);
+          }
+        }
+      }
+    }
+    REQUIRE(!result.nextFrame());
+
+    {
+      Y4mReader reader(inPath);
+      Y4mWriter writer(outPath, reader.format());
+      VideoConvPipeline<int, 3, 3, NUM_ROWS + 2, NUM_COLS, CHROMA_420> wrongSize(kernel);
+      REQUIRE(wrongSize.run(reader, writer) == -1);
+    }
+
+    remove(inPath.c_str());
+    remove(outPath.c_str());
+  }
+
+  TEST_CASE("Narrow element type video pipeline clamps instead of wrapping") {
+    const int NUM_ROWS = 6;
+    const int NUM_COLS = 8;
+    string inPath = tempTestPath("narrow-in.y4m");
+    string outPath = tempTestPath("narrow-out.y4m");
+
+    // A checkerboard of 0 and 120, which int8_t holds, through a
+    // sharpening cross: 5*120 on the bright squares and -4*120 on the
+    // dark ones, both past 8 bits and past int8_t.
+    auto sample = [](const int i, const int j) { return (i + j) % 2 == 0 ? 120 : 0; };
+
+    VideoFormat fmt(NUM_COLS, NUM_ROWS, CHROMA_MONO);
+    {
+      Y4mWriter writer(inPath, fmt);
+      writer.beginFrame();
+      vector<int> row(NUM_COLS);
+      for (int i = 0; i < NUM_ROWS; i++) {
+        for (int j = 0; j < NUM_COLS; j++) {
+          row[j] = sample(i, j);
+        }
+        writer.writeRow(0, row.data());
+      }
+      writer.flush();
+    }
+
+    Mem2D<int8_t, 3, 3> kernel;
+    kernel.set(1, 1, 5);
+    kernel.set(0, 1, -1);
+    kernel.set(2, 1, -1);
+    kernel.set(1, 0, -1);
+    kernel.set(1, 2, -1);
+
+    {
+      Y4mReader reader(inPath);
+      Y4mWriter writer(outPath, reader.format());
+      VideoConvPipeline<int8_t, 3, 3, NUM_ROWS, NUM_COLS, CHROMA_MONO> pipeline(kernel);
+      REQUIRE(pipeline.run(reader, writer) == 1);
+    }
+
+    Y4mReader result(outPath);
+    REQUIRE(result.nextFrame());
+    for (int i = 0; i < NUM_ROWS; i++) {
+      vector<int> row(NUM_COLS);
+      REQUIRE(result.readRow(0, row.data()));
+      for (int j = 0; j < NUM_COLS; j++) {
+        int ci = i < 1 ? 1 : (i > NUM_ROWS - 2 ? NUM_ROWS - 2 : i);
+        int cj = j < 1 ? 1 : (j > NUM_COLS - 2 ? NUM_COLS - 2 : j);
+        REQUIRE(row[j] == (sample(ci, cj) > 0 ? 255 : 0));
+      }
+    }
+
+    remove(inPath.c_str());
+    remove(outPath.c_str());
+  }
+
+}